@@ -0,0 +1,284 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <complex>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "ra/fft.hpp"
+#include "ra/lu.hpp"
+#include "ra/matrix_multiply.hpp"
+#include "ra/matrix_transpose.hpp"
+
+using namespace ra::cache;
+
+// Sweeps the recursion cutoffs of each algorithm for each element type and
+// writes the fastest ones as tuning<T> specialisations to a header.
+//
+//   autotune <output header> [benchmark options]
+
+using transpose_leaves =
+    std::integer_sequence<std::size_t, 16, 32, 64, 128, 256, 512, 1024>;
+using multiply_leaves =
+    std::integer_sequence<std::size_t, 8, 64, 512, 4096, 32768, 262144>;
+using fft_leaves = std::integer_sequence<std::size_t, 4, 8, 16, 32, 64>;
+using strassen_thresholds =
+    std::integer_sequence<std::size_t, 64, 128, 256, 512, 1024>;
+using solve_leaves = std::integer_sequence<std::size_t, 8, 16, 32, 64, 128>;
+
+template <class T> const char *type_name();
+template <> const char *type_name<std::int8_t>() { return "std::int8_t"; }
+template <> const char *type_name<std::int16_t>() { return "std::int16_t"; }
+template <> const char *type_name<std::int32_t>() { return "std::int32_t"; }
+template <> const char *type_name<std::int64_t>() { return "std::int64_t"; }
+template <> const char *type_name<float>() { return "float"; }
+template <> const char *type_name<double>() { return "double"; }
+template <> const char *type_name<long double>() { return "long double"; }
+template <> const char *type_name<std::complex<std::int8_t>>() {
+  return "std::complex<std::int8_t>";
+}
+template <> const char *type_name<std::complex<std::int16_t>>() {
+  return "std::complex<std::int16_t>";
+}
+template <> const char *type_name<std::complex<std::int32_t>>() {
+  return "std::complex<std::int32_t>";
+}
+template <> const char *type_name<std::complex<std::int64_t>>() {
+  return "std::complex<std::int64_t>";
+}
+template <> const char *type_name<std::complex<float>>() {
+  return "std::complex<float>";
+}
+template <> const char *type_name<std::complex<double>>() {
+  return "std::complex<double>";
+}
+template <> const char *type_name<std::complex<long double>>() {
+  return "std::complex<long double>";
+}
+
+template <class T, std::size_t Leaf>
+void BM_tune_transpose(benchmark::State &state) {
+  auto a = random_matrix<T>(state.range(0), state.range(1));
+  auto b = std::make_unique<T[]>(state.range(0) * state.range(1));
+  for (auto _ : state) {
+    matrix_transpose<T, Leaf>(a.get(), state.range(0), state.range(1),
+                              b.get());
+    benchmark::DoNotOptimize(b.get());
+  }
+}
+
+template <class T, std::size_t Leaf>
+void BM_tune_multiply(benchmark::State &state) {
+  auto a = random_matrix<T>(state.range(0), state.range(1));
+  auto b = random_matrix<T>(state.range(1), state.range(2));
+  auto c = random_matrix<T>(state.range(0), state.range(2));
+  for (auto _ : state) {
+    matrix_multiply<T, Leaf>(a.get(), b.get(), state.range(0), state.range(1),
+                             state.range(2), c.get());
+    benchmark::DoNotOptimize(c.get());
+  }
+}
+
+template <class T, std::size_t Threshold>
+void BM_tune_strassen(benchmark::State &state) {
+  auto a = random_matrix<T>(state.range(0), state.range(1));
+  auto b = random_matrix<T>(state.range(1), state.range(2));
+  auto c = random_matrix<T>(state.range(0), state.range(2));
+  for (auto _ : state) {
+    strassen_multiply<T, Threshold>(a.get(), b.get(), state.range(0),
+                                    state.range(1), state.range(2), c.get());
+    benchmark::DoNotOptimize(c.get());
+  }
+}
+
+// The factorization overwrites its input, copying it back is O(n^2) against
+// O(n^3) for the factorization and the same for every candidate
+template <class T, std::size_t Leaf>
+void BM_tune_solve(benchmark::State &state) {
+  std::size_t n = state.range(0);
+  auto a = random_matrix<T>(n, n);
+  auto b = std::make_unique<T[]>(n * n);
+  auto pivots = std::make_unique<std::size_t[]>(n);
+  for (auto _ : state) {
+    std::copy_n(a.get(), n * n, b.get());
+    lu_factor<T, Leaf>(b.get(), n, n, n, pivots.get());
+    benchmark::DoNotOptimize(b.get());
+  }
+}
+
+// An unnormalised transform scales the signal by sqrt(n), so each
+// iteration starts from the same input instead of the last one's output
+template <class T, std::size_t Leaf>
+void BM_tune_fft(benchmark::State &state) {
+  std::size_t n = state.range(0);
+  auto original = generate_random_vector<T>(n);
+  auto x = std::make_unique<T[]>(n);
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::copy_n(original.get(), n, x.get());
+    state.ResumeTiming();
+    forward_fft<T, Leaf>(x.get(), n);
+    benchmark::DoNotOptimize(x.get());
+  }
+}
+
+struct candidate {
+  std::string algorithm;
+  std::string type;
+  std::size_t leaf;
+};
+
+// Candidates by benchmark name
+std::map<std::string, candidate> candidates;
+
+benchmark::internal::Benchmark *
+register_candidate(const std::string &algorithm, const std::string &type,
+                   std::size_t leaf, void (*fn)(benchmark::State &)) {
+  std::string name = algorithm + "/" + type + "/" + std::to_string(leaf);
+  candidates[name] = {algorithm, type, leaf};
+  return benchmark::RegisterBenchmark(name.c_str(), fn);
+}
+
+template <class T, std::size_t... Leaves>
+void register_transpose(std::integer_sequence<std::size_t, Leaves...>) {
+  (register_candidate("transpose", type_name<T>(), Leaves,
+                      BM_tune_transpose<T, Leaves>)
+       ->Args({1024, 1024}),
+   ...);
+}
+
+template <class T, std::size_t... Leaves>
+void register_multiply(std::integer_sequence<std::size_t, Leaves...>) {
+  (register_candidate("multiply", type_name<T>(), Leaves,
+                      BM_tune_multiply<T, Leaves>)
+       ->Args({256, 256, 256}),
+   ...);
+}
+
+// At 1024^3 the largest threshold is the classical recursion
+template <class T, std::size_t... Thresholds>
+void register_strassen(std::integer_sequence<std::size_t, Thresholds...>) {
+  (register_candidate("strassen", type_name<T>(), Thresholds,
+                      BM_tune_strassen<T, Thresholds>)
+       ->Args({1024, 1024, 1024}),
+   ...);
+}
+
+template <class T, std::size_t... Leaves>
+void register_solve(std::integer_sequence<std::size_t, Leaves...>) {
+  (register_candidate("solve", type_name<T>(), Leaves,
+                      BM_tune_solve<T, Leaves>)
+       ->Args({512}),
+   ...);
+}
+
+template <class T, std::size_t... Leaves>
+void register_fft(std::integer_sequence<std::size_t, Leaves...>) {
+  (register_candidate("fft", type_name<T>(), Leaves, BM_tune_fft<T, Leaves>)
+       ->Args({1 << 16}),
+   ...);
+}
+
+template <class... Ts> void register_matrix_types() {
+  (register_transpose<Ts>(transpose_leaves()), ...);
+  (register_multiply<Ts>(multiply_leaves()), ...);
+  (register_strassen<Ts>(strassen_thresholds()), ...);
+}
+
+template <class... Ts> void register_solve_types() {
+  (register_solve<Ts>(solve_leaves()), ...);
+}
+
+template <class... Ts> void register_fft_types() {
+  (register_fft<Ts>(fft_leaves()), ...);
+}
+
+// Prints results as usual and keeps the fastest leaf per algorithm and type
+class tuning_reporter : public benchmark::ConsoleReporter {
+public:
+  void ReportRuns(const std::vector<Run> &reports) override {
+    ConsoleReporter::ReportRuns(reports);
+    for (const auto &run : reports) {
+      if (run.error_occurred || run.run_type != Run::RT_Iteration) {
+        continue;
+      }
+      auto it = candidates.find(run.run_name.function_name);
+      if (it == candidates.end()) {
+        continue;
+      }
+      const candidate &c = it->second;
+      auto &fastest = best_[c.type][c.algorithm];
+      double time = run.GetAdjustedRealTime();
+      if (time < fastest.time) {
+        fastest = {c.leaf, time};
+      }
+    }
+  }
+
+  void write(std::ostream &out) const {
+    out << "// Generated by the autotune target, rerun it instead of editing.\n"
+        << "#pragma once\n\n"
+        << "namespace ra::cache {\n";
+    for (const auto &[type, algorithms] : best_) {
+      out << "template <> struct tuning<" << type << "> : default_tuning<"
+          << type << "> {\n";
+      for (const auto &[algorithm, fastest] : algorithms) {
+        std::string field = algorithm == "strassen" ? "strassen_threshold"
+                                                    : algorithm + "_leaf";
+        out << "  static constexpr std::size_t " << field << " = "
+            << fastest.leaf << ";\n";
+      }
+      out << "};\n";
+    }
+    out << "} // namespace ra::cache\n";
+  }
+
+private:
+  struct result {
+    std::size_t leaf = 0;
+    double time = std::numeric_limits<double>::infinity();
+  };
+  std::map<std::string, std::map<std::string, result>> best_;
+};
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0]
+              << " <output header> [benchmark options]\n";
+    return 1;
+  }
+  std::string output = argv[1];
+  argv[1] = argv[0];
+  ++argv;
+  --argc;
+
+  register_matrix_types<std::int8_t, std::int16_t, std::int32_t, std::int64_t,
+                        float, double, std::complex<std::int8_t>,
+                        std::complex<std::int16_t>, std::complex<std::int32_t>,
+                        std::complex<std::int64_t>>();
+  register_solve_types<float, double>();
+  register_fft_types<std::complex<std::int8_t>, std::complex<std::int16_t>,
+                     std::complex<std::int32_t>, std::complex<std::int64_t>,
+                     std::complex<float>, std::complex<double>,
+                     std::complex<long double>>();
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  tuning_reporter reporter;
+  benchmark::RunSpecifiedBenchmarks(&reporter);
+
+  std::ofstream out(output);
+  if (!out) {
+    std::cerr << "Cannot write " << output << "\n";
+    return 1;
+  }
+  reporter.write(out);
+  return 0;
+}
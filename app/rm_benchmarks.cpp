@@ -1,9 +1,25 @@
 #include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <cstdint>
+#include <cstdlib>
+#include <filesystem>
 #include <memory>
+#include <random>
+#include <string>
+#include <vector>
 
+#include "ra/mapped_fft.hpp"
+#include "ra/mapped_transpose.hpp"
 #include "ra/matrix_transpose.hpp"
 #include "ra/matrix_multiply.hpp"
+#include "ra/morton_matrix.hpp"
+#include "ra/cholesky.hpp"
+#include "ra/convolution.hpp"
+#include "ra/lu.hpp"
+#include "ra/triangular_solve.hpp"
 #include "ra/fft.hpp"
 
 using namespace ra::cache;
@@ -30,6 +46,139 @@ static void BM_transpose(benchmark::State& state) {
   }
 }
 
+static void BM_naive_transpose_in_place(benchmark::State& state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+		auto a = random_matrix<std::int32_t>(state.range(0), state.range(1));
+    state.ResumeTiming();
+		naive_matrix_transpose<std::int32_t>(a.get(), state.range(0), state.range(1), a.get());
+  }
+}
+
+static void BM_transpose_in_place(benchmark::State& state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+		auto a = random_matrix<std::int32_t>(state.range(0), state.range(1));
+    state.ResumeTiming();
+		matrix_transpose<std::int32_t>(a.get(), state.range(0), state.range(1), a.get());
+  }
+}
+
+static void BM_transpose_threads(benchmark::State& state) {
+	thread_pool pool(state.range(2));
+  for (auto _ : state) {
+    state.PauseTiming();
+		auto a = random_matrix<std::int32_t>(state.range(0), state.range(1));
+		auto b = std::make_unique<std::int32_t[]>(state.range(0) * state.range(1));
+    state.ResumeTiming();
+		matrix_transpose<std::int32_t>(a.get(), state.range(0), state.range(1), b.get(), pool);
+  }
+}
+
+// Twiddles on the unit circle, so that repeated multiplies stay finite
+static std::unique_ptr<std::complex<double>[]> unit_twiddles(std::size_t n) {
+	auto w = std::make_unique<std::complex<double>[]>(n);
+	for (std::size_t i = 0; i < n; ++i) {
+		w[i] = std::polar(1.0, 0.001 * i);
+	}
+	return w;
+}
+
+// Elementwise multiply followed by an in-place transpose, against the two
+// fused into one pass with transform_transpose
+static void BM_twiddle_transpose(benchmark::State& state) {
+	std::size_t m = state.range(0);
+	std::size_t n = state.range(1);
+	auto x = generate_random_vector<std::complex<double>>(m * n);
+	auto w = unit_twiddles(m * n);
+  for (auto _ : state) {
+		for (std::size_t i = 0; i < m * n; ++i) {
+			x[i] = mul_no_nan(x[i], w[i]);
+		}
+		matrix_transpose<std::complex<double>>(x.get(), m, n, x.get());
+		benchmark::DoNotOptimize(x.get());
+  }
+}
+
+static void BM_fused_twiddle_transpose(benchmark::State& state) {
+	std::size_t m = state.range(0);
+	std::size_t n = state.range(1);
+	auto x = generate_random_vector<std::complex<double>>(m * n);
+	auto w = unit_twiddles(m * n);
+	const std::complex<double>* twiddles = w.get();
+  for (auto _ : state) {
+		transform_transpose<std::complex<double>>(
+				x.get(), m, n, x.get(),
+				[twiddles, n](const std::complex<double>& v, std::size_t i,
+				              std::size_t j) {
+					return mul_no_nan(v, twiddles[i * n + j]);
+				});
+		benchmark::DoNotOptimize(x.get());
+  }
+}
+
+/* Out-of-core Matrix Transposition */
+
+// Benchmark files go to $RA_BENCH_DIR, or the temporary directory if unset
+static std::string bench_file(const char* name) {
+	const char* dir = std::getenv("RA_BENCH_DIR");
+	auto path = dir ? std::filesystem::path(dir) : std::filesystem::temp_directory_path();
+	return (path / name).string();
+}
+
+// Fills a file with a random m x n matrix without holding it in memory
+template <class T> void write_matrix_file(const std::string& path, std::size_t m, std::size_t n) {
+	std::mt19937 rng(0xDEADBEEF);
+	mapped_file file(path, m * n * sizeof(T));
+	T* a = static_cast<T*>(file.data());
+	for (std::size_t i = 0; i < m * n; ++i) {
+		a[i] = T(rng());
+	}
+	file.sync();
+}
+
+// Drops a file from the page cache so that every run starts cold
+static void evict_file(const std::string& path) {
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd >= 0) {
+		fdatasync(fd);
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		close(fd);
+	}
+}
+
+static void BM_naive_transpose_file(benchmark::State& state) {
+	auto in = bench_file("ra_bench_transpose_in.bin");
+	auto out = bench_file("ra_bench_transpose_out.bin");
+	write_matrix_file<std::int32_t>(in, state.range(0), state.range(1));
+  for (auto _ : state) {
+    state.PauseTiming();
+		evict_file(in);
+		evict_file(out);
+    state.ResumeTiming();
+		naive_matrix_transpose_file<std::int32_t>(in, state.range(0), state.range(1), out,
+				static_cast<map_advice>(state.range(2)));
+  }
+	std::filesystem::remove(in);
+	std::filesystem::remove(out);
+}
+
+static void BM_transpose_file(benchmark::State& state) {
+	auto in = bench_file("ra_bench_transpose_in.bin");
+	auto out = bench_file("ra_bench_transpose_out.bin");
+	write_matrix_file<std::int32_t>(in, state.range(0), state.range(1));
+  for (auto _ : state) {
+    state.PauseTiming();
+		evict_file(in);
+		evict_file(out);
+    state.ResumeTiming();
+		matrix_transpose_file<std::int32_t>(in, state.range(0), state.range(1), out,
+				static_cast<map_advice>(state.range(2)));
+  }
+	std::filesystem::remove(in);
+	std::filesystem::remove(out);
+}
+
 template <class T> void BM_naive_transpose_types(benchmark::State& state) {
   for (auto _ : state) {
     state.PauseTiming();
@@ -74,6 +223,35 @@ static void BM_multiply(benchmark::State& state) {
   }
 }
 
+// Blocked for the caches detected at runtime, which the label reports
+static void BM_packed_multiply(benchmark::State& state) {
+	packed_blocking blocking = make_packed_blocking<std::int32_t>(detect_cache_sizes());
+  for (auto _ : state) {
+    state.PauseTiming();
+		auto a = random_matrix<std::int32_t>(state.range(0), state.range(1));
+		auto b = random_matrix<std::int32_t>(state.range(1), state.range(2));
+		auto c = random_matrix<std::int32_t>(state.range(0), state.range(2));
+    state.ResumeTiming();
+		packed_matrix_multiply(a.get(), b.get(), state.range(0), state.range(1), state.range(2), c.get(), blocking);
+  }
+	state.SetLabel("mc=" + std::to_string(blocking.mc) + " kc=" + std::to_string(blocking.kc) +
+			" nc=" + std::to_string(blocking.nc));
+}
+
+static void BM_multiply_threads(benchmark::State& state) {
+	thread_pool pool(state.range(3));
+	auto a = random_matrix<std::int32_t>(state.range(0), state.range(1));
+	auto b = random_matrix<std::int32_t>(state.range(1), state.range(2));
+	auto c = random_matrix<std::int32_t>(state.range(0), state.range(2));
+  for (auto _ : state) {
+		matrix_multiply<std::int32_t>(a.get(), b.get(), state.range(0), state.range(1), state.range(2), c.get(), pool);
+		benchmark::DoNotOptimize(c.get());
+  }
+	state.counters["FLOPS"] = benchmark::Counter(
+			2.0 * state.range(0) * state.range(1) * state.range(2),
+			benchmark::Counter::kIsIterationInvariantRate);
+}
+
 template <class T> void BM_naive_multiply_types(benchmark::State& state) {
   for (auto _ : state) {
     state.PauseTiming();
@@ -96,6 +274,268 @@ template <class T> void BM_multiply_types(benchmark::State& state) {
   }
 }
 
+// Inputs of type T accumulated in the wider U
+template <class T, class U> void BM_widening_multiply_types(benchmark::State& state) {
+	auto a = random_matrix<T>(state.range(0), state.range(1));
+	auto b = random_matrix<T>(state.range(1), state.range(2));
+	auto c = std::make_unique<U[]>(state.range(0) * state.range(2));
+  for (auto _ : state) {
+		matrix_multiply(a.get(), b.get(), state.range(0), state.range(1), state.range(2), c.get());
+		benchmark::DoNotOptimize(c.get());
+  }
+	state.counters["OPS"] = benchmark::Counter(
+			2.0 * state.range(0) * state.range(1) * state.range(2),
+			benchmark::Counter::kIsIterationInvariantRate);
+}
+
+template <class T> void BM_strassen_multiply_types(benchmark::State& state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+		auto a = random_matrix<T>(state.range(0), state.range(1));
+		auto b = random_matrix<T>(state.range(1), state.range(2));
+		auto c = random_matrix<T>(state.range(0), state.range(2));
+    state.ResumeTiming();
+		strassen_multiply<T>(a.get(), b.get(), state.range(0), state.range(1), state.range(2), c.get());
+  }
+}
+
+// c = 2 op(a) op(b) + 3 c with range(3) and range(4) selecting transposes
+static void BM_gemm(benchmark::State& state) {
+	std::size_t m = state.range(0);
+	std::size_t n = state.range(1);
+	std::size_t p = state.range(2);
+	matrix_op op_a = state.range(3) ? matrix_op::transpose : matrix_op::none;
+	matrix_op op_b = state.range(4) ? matrix_op::transpose : matrix_op::none;
+	auto a = random_matrix<float>(m, n);
+	auto b = random_matrix<float>(n, p);
+	auto c = random_matrix<float>(m, p);
+  for (auto _ : state) {
+		gemm<float>(op_a, op_b, m, n, p, 2, a.get(), state.range(3) ? m : n, b.get(), state.range(4) ? n : p, 3, c.get(), p);
+		benchmark::DoNotOptimize(c.get());
+  }
+}
+
+// The same through explicit transposes and scaling passes around matrix_multiply
+static void BM_gemm_explicit(benchmark::State& state) {
+	std::size_t m = state.range(0);
+	std::size_t n = state.range(1);
+	std::size_t p = state.range(2);
+	auto a = random_matrix<float>(m, n);
+	auto b = random_matrix<float>(n, p);
+	auto c = random_matrix<float>(m, p);
+	auto at = std::make_unique<float[]>(m * n);
+	auto bt = std::make_unique<float[]>(n * p);
+  for (auto _ : state) {
+		const float *op_a = a.get();
+		const float *op_b = b.get();
+		if (state.range(3)) {
+			matrix_transpose<float>(a.get(), n, m, at.get());
+			op_a = at.get();
+		}
+		if (state.range(4)) {
+			matrix_transpose<float>(b.get(), p, n, bt.get());
+			op_b = bt.get();
+		}
+		for (std::size_t i = 0; i < m * p; ++i) {
+			c.get()[i] *= 1.5f;
+		}
+		matrix_multiply<float>(op_a, op_b, m, n, p, c.get());
+		for (std::size_t i = 0; i < m * p; ++i) {
+			c.get()[i] *= 2;
+		}
+		benchmark::DoNotOptimize(c.get());
+  }
+}
+
+/* Morton Order */
+
+// range(2) == 1 times conversion from and back to row-major as well
+static void BM_morton_transpose(benchmark::State& state) {
+	std::size_t m = state.range(0);
+	std::size_t n = state.range(1);
+	auto a = random_matrix<std::int32_t>(m, n);
+	auto b = std::make_unique<std::int32_t[]>(m * n);
+	morton_matrix<std::int32_t> ma(a.get(), m, n);
+	morton_matrix<std::int32_t> mb(n, m);
+  for (auto _ : state) {
+		if (state.range(2)) {
+			ma.from_row_major(a.get());
+			matrix_transpose(ma, mb);
+			mb.to_row_major(b.get());
+		} else {
+			matrix_transpose(ma, mb);
+		}
+		benchmark::DoNotOptimize(mb.tile_data(0, 0));
+  }
+}
+
+// range(3) == 1 times conversion from and back to row-major as well
+static void BM_morton_multiply(benchmark::State& state) {
+	std::size_t m = state.range(0);
+	std::size_t n = state.range(1);
+	std::size_t p = state.range(2);
+	auto a = random_matrix<std::int32_t>(m, n);
+	auto b = random_matrix<std::int32_t>(n, p);
+	auto c = random_matrix<std::int32_t>(m, p);
+	morton_matrix<std::int32_t> ma(a.get(), m, n);
+	morton_matrix<std::int32_t> mb(b.get(), n, p);
+	morton_matrix<std::int32_t> mc(c.get(), m, p);
+  for (auto _ : state) {
+		if (state.range(3)) {
+			ma.from_row_major(a.get());
+			mb.from_row_major(b.get());
+			mc.from_row_major(c.get());
+			matrix_multiply(ma, mb, mc);
+			mc.to_row_major(c.get());
+		} else {
+			matrix_multiply(ma, mb, mc);
+		}
+		benchmark::DoNotOptimize(mc.tile_data(0, 0));
+  }
+}
+
+/* Dense Factorizations */
+
+// Random n x n matrix, diagonally dominant so that every variant stays
+// regular and positive definite where needed
+static std::unique_ptr<double[]> dominant_matrix(std::size_t n) {
+	std::mt19937 rng(0xDEADBEEF);
+	std::uniform_real_distribution<double> dis(-1, 1);
+	auto a = std::make_unique<double[]>(n * n);
+	for (std::size_t i = 0; i < n; ++i) {
+		for (std::size_t j = 0; j <= i; ++j) {
+			a[i * n + j] = a[j * n + i] = dis(rng);
+		}
+		a[i * n + i] += n;
+	}
+	return a;
+}
+
+static void BM_naive_lu(benchmark::State& state) {
+	std::size_t n = state.range(0);
+	auto a = dominant_matrix(n);
+	auto b = std::make_unique<double[]>(n * n);
+	auto pivots = std::make_unique<std::size_t[]>(n);
+  for (auto _ : state) {
+    state.PauseTiming();
+		std::copy_n(a.get(), n * n, b.get());
+    state.ResumeTiming();
+		naive_lu_factor(b.get(), n, n, n, pivots.get());
+  }
+}
+
+static void BM_lu(benchmark::State& state) {
+	std::size_t n = state.range(0);
+	auto a = dominant_matrix(n);
+	auto b = std::make_unique<double[]>(n * n);
+	auto pivots = std::make_unique<std::size_t[]>(n);
+  for (auto _ : state) {
+    state.PauseTiming();
+		std::copy_n(a.get(), n * n, b.get());
+    state.ResumeTiming();
+		lu_factor(b.get(), n, n, n, pivots.get());
+  }
+}
+
+static void BM_naive_cholesky(benchmark::State& state) {
+	std::size_t n = state.range(0);
+	auto a = dominant_matrix(n);
+	auto b = std::make_unique<double[]>(n * n);
+  for (auto _ : state) {
+    state.PauseTiming();
+		std::copy_n(a.get(), n * n, b.get());
+    state.ResumeTiming();
+		naive_cholesky_factor(b.get(), n, n);
+  }
+}
+
+static void BM_cholesky(benchmark::State& state) {
+	std::size_t n = state.range(0);
+	auto a = dominant_matrix(n);
+	auto b = std::make_unique<double[]>(n * n);
+  for (auto _ : state) {
+    state.PauseTiming();
+		std::copy_n(a.get(), n * n, b.get());
+    state.ResumeTiming();
+		cholesky_factor(b.get(), n, n);
+  }
+}
+
+// Lower triangle of range(0) x range(0) against range(1) right-hand sides
+static void BM_naive_triangular_solve(benchmark::State& state) {
+	std::size_t n = state.range(0);
+	std::size_t nrhs = state.range(1);
+	auto a = dominant_matrix(n);
+	auto b = random_matrix<double>(n, nrhs);
+	auto x = std::make_unique<double[]>(n * nrhs);
+  for (auto _ : state) {
+    state.PauseTiming();
+		std::copy_n(b.get(), n * nrhs, x.get());
+    state.ResumeTiming();
+		naive_triangular_solve(matrix_side::left, matrix_triangle::lower,
+				matrix_op::none, matrix_diagonal::non_unit, n, nrhs, a.get(), n, x.get(), nrhs);
+  }
+}
+
+static void BM_triangular_solve(benchmark::State& state) {
+	std::size_t n = state.range(0);
+	std::size_t nrhs = state.range(1);
+	auto a = dominant_matrix(n);
+	auto b = random_matrix<double>(n, nrhs);
+	auto x = std::make_unique<double[]>(n * nrhs);
+  for (auto _ : state) {
+    state.PauseTiming();
+		std::copy_n(b.get(), n * nrhs, x.get());
+    state.ResumeTiming();
+		triangular_solve(matrix_side::left, matrix_triangle::lower,
+				matrix_op::none, matrix_diagonal::non_unit, n, nrhs, a.get(), n, x.get(), nrhs);
+  }
+}
+
+/* Batched Small Matrices */
+
+// Arguments: batch size, matrix side length, threads (0 to loop over the
+// single matrix functions instead)
+
+static void BM_batched_transpose(benchmark::State& state) {
+	std::size_t batch = state.range(0);
+	std::size_t n = state.range(1);
+	thread_pool pool(std::max<std::int64_t>(state.range(2), 1));
+	auto a = random_matrix<std::int32_t>(batch, n * n);
+	auto b = std::make_unique<std::int32_t[]>(batch * n * n);
+  for (auto _ : state) {
+		if (state.range(2) == 0) {
+			for (std::size_t k = 0; k < batch; ++k) {
+				matrix_transpose<std::int32_t>(a.get() + k * n * n, n, n, b.get() + k * n * n);
+			}
+		} else {
+			batched_matrix_transpose<std::int32_t>(a.get(), n, n, b.get(), batch, n * n, n * n, pool);
+		}
+		benchmark::DoNotOptimize(b.get());
+  }
+	state.SetItemsProcessed(state.iterations() * batch);
+}
+
+static void BM_batched_multiply(benchmark::State& state) {
+	std::size_t batch = state.range(0);
+	std::size_t n = state.range(1);
+	thread_pool pool(std::max<std::int64_t>(state.range(2), 1));
+	auto a = random_matrix<std::int32_t>(batch, n * n);
+	auto b = random_matrix<std::int32_t>(batch, n * n);
+	auto c = random_matrix<std::int32_t>(batch, n * n);
+  for (auto _ : state) {
+		if (state.range(2) == 0) {
+			for (std::size_t k = 0; k < batch; ++k) {
+				matrix_multiply<std::int32_t>(a.get() + k * n * n, b.get() + k * n * n, n, n, n, c.get() + k * n * n);
+			}
+		} else {
+			batched_matrix_multiply<std::int32_t>(a.get(), b.get(), n, n, n, c.get(), batch, n * n, n * n, n * n, pool);
+		}
+		benchmark::DoNotOptimize(c.get());
+  }
+	state.SetItemsProcessed(state.iterations() * batch);
+}
+
 /* Fast Fourier Transform */
 
 static void BM_naive_fft(benchmark::State& state) {
@@ -103,7 +543,18 @@ static void BM_naive_fft(benchmark::State& state) {
     state.PauseTiming();
 		auto x = generate_random_vector<std::complex<std::int32_t>>(state.range(0));
     state.ResumeTiming();
-		dit_fft<std::complex<std::int32_t>>(x.get(), state.range(0));
+		iterative_fft<std::complex<std::int32_t>>(x.get(), state.range(0));
+  }
+}
+
+// Recursive radix-2 with a heap allocation per node, for comparison with
+// the allocation-free baseline
+static void BM_dit_fft(benchmark::State& state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+		auto x = generate_random_vector<std::complex<std::int32_t>>(state.range(0));
+    state.ResumeTiming();
+		delete[] dit_fft<std::complex<std::int32_t>>(x.get(), state.range(0));
   }
 }
 
@@ -116,12 +567,95 @@ static void BM_fft(benchmark::State& state) {
   }
 }
 
+// Plan built once and reused, as for repeated transforms of one length
+static void BM_fft_plan(benchmark::State& state) {
+	fft_plan<std::complex<std::int32_t>> plan(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+		auto x = generate_random_vector<std::complex<std::int32_t>>(state.range(0));
+    state.ResumeTiming();
+		plan.forward(x.get());
+  }
+}
+
+// Top level of fft_plan::forward with the twiddle multiply as a pass of its
+// own between the sub-transform batches, as it was before the twiddles were
+// applied per row. The sub-transforms are planned by the library. Lengths
+// fft_plan does not split are left to the plan.
+template <class T> class twiddle_pass_fft {
+public:
+	explicit twiddle_pass_fft(std::size_t n)
+	    : plan_(n), n1_(0), n2_(n > tuning<T>::fft_leaf ? fft_split(n) : 0) {
+		if (n2_ == 0) {
+			return;
+		}
+		n1_ = n / n2_;
+		first_ = std::make_unique<fft_plan<T>>(n1_);
+		second_ = std::make_unique<fft_plan<T>>(n2_);
+		twiddles_ = std::make_unique<T[]>(n);
+		for (std::size_t i = 0; i < n2_; ++i) {
+			for (std::size_t j = 0; j < n1_; ++j) {
+				twiddles_[i * n1_ + j] = plan_.roots()[i * j % n];
+			}
+		}
+	}
+
+	void forward(T* x) const {
+		if (n2_ == 0) {
+			plan_.forward(x);
+			return;
+		}
+		matrix_transpose<T>(x, n1_, n2_, x);
+		for (std::size_t i = 0; i < n2_; ++i) {
+			first_->forward(x + n1_ * i);
+		}
+		for (std::size_t i = 0; i < n1_ * n2_; ++i) {
+			x[i] = mul_no_nan(x[i], twiddles_[i]);
+		}
+		matrix_transpose<T>(x, n2_, n1_, x);
+		for (std::size_t i = 0; i < n1_; ++i) {
+			second_->forward(x + n2_ * i);
+		}
+		matrix_transpose<T>(x, n1_, n2_, x);
+	}
+
+private:
+	fft_plan<T> plan_;
+	std::size_t n1_;
+	std::size_t n2_;
+	std::unique_ptr<fft_plan<T>> first_;
+	std::unique_ptr<fft_plan<T>> second_;
+	std::unique_ptr<T[]> twiddles_;
+};
+
+// The six-step FFT with the twiddles applied to each row after its
+// sub-transform, against a separate twiddle pass over the whole signal
+static void BM_fft_twiddle_rows(benchmark::State& state) {
+	fft_plan<std::complex<double>> plan(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+		auto x = generate_random_vector<std::complex<double>>(state.range(0));
+    state.ResumeTiming();
+		plan.forward(x.get());
+  }
+}
+
+static void BM_fft_twiddle_pass(benchmark::State& state) {
+	twiddle_pass_fft<std::complex<double>> plan(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+		auto x = generate_random_vector<std::complex<double>>(state.range(0));
+    state.ResumeTiming();
+		plan.forward(x.get());
+  }
+}
+
 template <class T> void BM_naive_fft_types(benchmark::State& state) {
   for (auto _ : state) {
     state.PauseTiming();
 		auto x = generate_random_vector<std::complex<T>>(state.range(0));
     state.ResumeTiming();
-		dit_fft<std::complex<T>>(x.get(), state.range(0));
+		iterative_fft<std::complex<T>>(x.get(), state.range(0));
   }
 }
 
@@ -134,6 +668,229 @@ template <class T> void BM_fft_types(benchmark::State& state) {
   }
 }
 
+// Arguments: transform length, threads
+static void BM_fft_threads(benchmark::State& state) {
+	std::size_t n = state.range(0);
+	thread_pool pool(state.range(1));
+	fft_plan<std::complex<double>> plan(n);
+	auto original = generate_random_vector<std::complex<double>>(n);
+	auto x = std::make_unique<std::complex<double>[]>(n);
+  for (auto _ : state) {
+    state.PauseTiming();
+		std::copy_n(original.get(), n, x.get());
+    state.ResumeTiming();
+		plan.forward(x.get(), pool);
+  }
+}
+
+// Interleaved std::complex against split real and imaginary arrays, each
+// with its plan built once
+template <class T> void BM_fft_interleaved(benchmark::State& state) {
+	std::size_t n = state.range(0);
+	fft_plan<std::complex<T>> plan(n);
+	auto original = generate_random_vector<std::complex<T>>(n);
+	auto x = std::make_unique<std::complex<T>[]>(n);
+  for (auto _ : state) {
+    state.PauseTiming();
+		std::copy_n(original.get(), n, x.get());
+    state.ResumeTiming();
+		plan.forward(x.get());
+  }
+}
+
+template <class T> void BM_fft_split(benchmark::State& state) {
+	std::size_t n = state.range(0);
+	split_fft_plan<T> plan(n);
+	auto original = generate_random_vector<std::complex<T>>(n);
+	std::vector<T> re(n);
+	std::vector<T> im(n);
+  for (auto _ : state) {
+    state.PauseTiming();
+		deinterleave(original.get(), n, re.data(), im.data());
+    state.ResumeTiming();
+		plan.forward(re.data(), im.data());
+  }
+}
+
+// Real input, n / 2 + 1 outputs through the half length transform
+template <class T> void BM_real_fft(benchmark::State& state) {
+	std::size_t n = state.range(0);
+	real_fft_plan<std::complex<T>> plan(n);
+	auto v = generate_random_vector<std::complex<T>>(n);
+	std::vector<T> x(n);
+	for (std::size_t i = 0; i < n; ++i) {
+		x[i] = v[i].real();
+	}
+	std::vector<std::complex<T>> y(n / 2 + 1);
+  for (auto _ : state) {
+		plan.forward(x.data(), y.data());
+		benchmark::DoNotOptimize(y.data());
+  }
+}
+
+// The same real input widened to complex and put through the full transform
+template <class T> void BM_real_fft_complex_path(benchmark::State& state) {
+	std::size_t n = state.range(0);
+	fft_plan<std::complex<T>> plan(n);
+	auto v = generate_random_vector<std::complex<T>>(n);
+	std::vector<T> x(n);
+	for (std::size_t i = 0; i < n; ++i) {
+		x[i] = v[i].real();
+	}
+	std::vector<std::complex<T>> y(n);
+  for (auto _ : state) {
+		for (std::size_t i = 0; i < n; ++i) {
+			y[i] = std::complex<T>(x[i], T(0));
+		}
+		plan.forward(y.data());
+		benchmark::DoNotOptimize(y.data());
+  }
+}
+
+template <class T> void BM_real_inverse_fft(benchmark::State& state) {
+	std::size_t n = state.range(0);
+	real_fft_plan<std::complex<T>> plan(n);
+	auto spectrum = generate_random_vector<std::complex<T>>(n / 2 + 1);
+	std::vector<std::complex<T>> y(n / 2 + 1);
+	std::vector<T> x(n);
+  for (auto _ : state) {
+    state.PauseTiming();
+		std::copy_n(spectrum.get(), n / 2 + 1, y.begin());
+    state.ResumeTiming();
+		plan.inverse(y.data(), x.data());
+		benchmark::DoNotOptimize(x.data());
+  }
+}
+
+// Square 2D transform with the row and column passes hand-rolled: rows in
+// place, columns gathered into a contiguous buffer one at a time
+template <class T> void BM_naive_fft_2d(benchmark::State& state) {
+	std::size_t n = state.range(0);
+	auto original = generate_random_vector<std::complex<T>>(n * n);
+	auto x = std::make_unique<std::complex<T>[]>(n * n);
+	std::vector<std::complex<T>> column(n);
+  for (auto _ : state) {
+    state.PauseTiming();
+		std::copy_n(original.get(), n * n, x.get());
+    state.ResumeTiming();
+		for (std::size_t i = 0; i < n; ++i) {
+			iterative_fft(x.get() + i * n, n);
+		}
+		for (std::size_t j = 0; j < n; ++j) {
+			for (std::size_t i = 0; i < n; ++i) {
+				column[i] = x[i * n + j];
+			}
+			iterative_fft(column.data(), n);
+			for (std::size_t i = 0; i < n; ++i) {
+				x[i * n + j] = column[i];
+			}
+		}
+  }
+}
+
+// Square 2D and cubic 3D transforms, axes reoriented by the transpose
+template <class T> void BM_fft_2d(benchmark::State& state) {
+	std::size_t n = state.range(0);
+	multi_fft_plan<std::complex<T>> plan({n, n});
+	auto original = generate_random_vector<std::complex<T>>(n * n);
+	auto x = std::make_unique<std::complex<T>[]>(n * n);
+  for (auto _ : state) {
+    state.PauseTiming();
+		std::copy_n(original.get(), n * n, x.get());
+    state.ResumeTiming();
+		plan.forward(x.get());
+  }
+}
+
+template <class T> void BM_fft_3d(benchmark::State& state) {
+	std::size_t n = state.range(0);
+	multi_fft_plan<std::complex<T>> plan({n, n, n});
+	auto original = generate_random_vector<std::complex<T>>(n * n * n);
+	auto x = std::make_unique<std::complex<T>[]>(n * n * n);
+  for (auto _ : state) {
+    state.PauseTiming();
+		std::copy_n(original.get(), n * n * n, x.get());
+    state.ResumeTiming();
+		plan.forward(x.get());
+  }
+}
+
+/* Out-of-core Fast Fourier Transform */
+
+// Fills a file with n random complex values without holding them in memory
+template <class T> void write_signal_file(const std::string& path, std::size_t n) {
+	std::mt19937 rng(0xDEADBEEF);
+	std::uniform_real_distribution<typename T::value_type> dis(-1, 1);
+	mapped_file file(path, n * sizeof(T));
+	T* x = static_cast<T*>(file.data());
+	for (std::size_t i = 0; i < n; ++i) {
+		x[i] = T(dis(rng), dis(rng));
+	}
+	file.sync();
+}
+
+// Arguments: transform length, memory budget in MiB
+static void BM_fft_file(benchmark::State& state) {
+	using C = std::complex<float>;
+	auto in = bench_file("ra_bench_fft_in.bin");
+	auto out = bench_file("ra_bench_fft_out.bin");
+	write_signal_file<C>(in, state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+		evict_file(in);
+		evict_file(out);
+    state.ResumeTiming();
+		forward_fft_file<C>(in, state.range(0), out, state.range(1) << 20);
+  }
+	state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(C));
+	std::filesystem::remove(in);
+	std::filesystem::remove(out);
+}
+
+/* Convolution */
+
+// Real signal of range(0) values filtered with a kernel of range(1) values
+template <class T> void BM_naive_convolve(benchmark::State& state) {
+	std::size_t n = state.range(0);
+	std::size_t k = state.range(1);
+	auto v = generate_random_vector<std::complex<T>>(std::max(n, k));
+	std::vector<T> x(n);
+	std::vector<T> kernel(k);
+	for (std::size_t i = 0; i < n; ++i) {
+		x[i] = v[i].real();
+	}
+	for (std::size_t i = 0; i < k; ++i) {
+		kernel[i] = v[i].imag();
+	}
+	std::vector<T> y(n + k - 1);
+  for (auto _ : state) {
+		naive_convolve(x.data(), n, kernel.data(), k, y.data());
+		benchmark::DoNotOptimize(y.data());
+  }
+}
+
+// Overlap-save with a convolver built once, as for streaming signals
+template <class T> void BM_convolve(benchmark::State& state) {
+	std::size_t n = state.range(0);
+	std::size_t k = state.range(1);
+	auto v = generate_random_vector<std::complex<T>>(std::max(n, k));
+	std::vector<T> x(n);
+	std::vector<T> kernel(k);
+	for (std::size_t i = 0; i < n; ++i) {
+		x[i] = v[i].real();
+	}
+	for (std::size_t i = 0; i < k; ++i) {
+		kernel[i] = v[i].imag();
+	}
+	convolver<std::complex<T>> filter(kernel.data(), k);
+	std::vector<T> y(n + k - 1);
+	state.SetLabel("block " + std::to_string(filter.block_size()));
+  for (auto _ : state) {
+		filter.filter(x.data(), n, y.data());
+		benchmark::DoNotOptimize(y.data());
+  }
+}
+
 /* Matrix Transposition */
 
 // Naive transposition, varying sizes
@@ -188,6 +945,89 @@ BENCHMARK(BM_transpose)
 	->Args({10000, 5000})
 	->Args({10000, 10000});
 
+// Naive in-place transposition, varying sizes
+
+BENCHMARK(BM_naive_transpose_in_place)
+	->Args({100, 100})
+	->Args({100, 500})
+	->Args({500, 100})
+	->Args({500, 500})
+	->Args({1000, 1000})
+	->Args({1000, 5000})
+	->Args({5000, 1000})
+	->Args({5000, 5000})
+	->Args({5000, 10000})
+	->Args({10000, 5000})
+	->Args({10000, 10000});
+
+// Cache-oblivious in-place transposition, varying sizes
+
+BENCHMARK(BM_transpose_in_place)
+	->Args({100, 100})
+	->Args({100, 500})
+	->Args({500, 100})
+	->Args({500, 500})
+	->Args({1000, 1000})
+	->Args({1000, 5000})
+	->Args({5000, 1000})
+	->Args({5000, 5000})
+	->Args({5000, 10000})
+	->Args({10000, 5000})
+	->Args({10000, 10000});
+
+// Separate and fused twiddle multiply and transpose
+
+BENCHMARK(BM_twiddle_transpose)
+	->Args({1024, 1024})
+	->Args({1024, 2048})
+	->Args({2048, 2048})
+	->Args({2048, 4096});
+
+BENCHMARK(BM_fused_twiddle_transpose)
+	->Args({1024, 1024})
+	->Args({1024, 2048})
+	->Args({2048, 2048})
+	->Args({2048, 4096});
+
+// Cache-oblivious parallel transposition, varying thread counts
+
+BENCHMARK(BM_transpose_threads)
+	->Args({5000, 5000, 1})
+	->Args({5000, 5000, 2})
+	->Args({5000, 5000, 4})
+	->Args({5000, 5000, 8})
+	->Args({5000, 5000, 16})
+	->Args({10000, 10000, 1})
+	->Args({10000, 10000, 2})
+	->Args({10000, 10000, 4})
+	->Args({10000, 10000, 8})
+	->Args({10000, 10000, 16})
+	->UseRealTime();
+
+// Out-of-core transposition of cold files, varying sizes and madvise hints
+// (third argument: 0 normal, 1 sequential, 2 random, 3 will need, 4 huge page)
+
+BENCHMARK(BM_naive_transpose_file)
+	->Args({4096, 4096, 0})
+	->Args({8192, 8192, 0})
+	->Args({16384, 16384, 0})
+	->Args({16384, 16384, 2})
+	->Args({32768, 32768, 0})
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
+
+BENCHMARK(BM_transpose_file)
+	->Args({4096, 4096, 0})
+	->Args({8192, 8192, 0})
+	->Args({16384, 16384, 0})
+	->Args({16384, 16384, 1})
+	->Args({16384, 16384, 2})
+	->Args({16384, 16384, 3})
+	->Args({16384, 16384, 4})
+	->Args({32768, 32768, 0})
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
+
 // Naive transposition, varying types
 
 BENCHMARK_TEMPLATE(BM_naive_transpose_types, std::int8_t)->Args({512, 512});
@@ -320,6 +1160,45 @@ BENCHMARK(BM_multiply)
 	->Args({4096, 1024, 4096})
 	->Args({1024, 4096, 1024});
 
+// Cache-aware packed multiplication, the same sizes
+
+BENCHMARK(BM_packed_multiply)
+	->Args({8, 8, 8})
+	->Args({16, 4, 16})
+	->Args({4, 16, 4})
+	->Args({16, 16, 16})
+	->Args({32, 8, 32})
+	->Args({8, 32, 8})
+	->Args({32, 32, 32})
+	->Args({64, 16, 64})
+	->Args({16, 64, 16})
+	->Args({64, 64, 64})
+	->Args({128, 32, 128})
+	->Args({32, 128, 32})
+	->Args({128, 128, 128})
+	->Args({256, 64, 256})
+	->Args({64, 256, 64})
+	->Args({256, 256, 256})
+	->Args({512, 128, 512})
+	->Args({128, 512, 128})
+	->Args({512, 512, 512})
+	->Args({1024, 256, 1024})
+	->Args({256, 1024, 256})
+	->Args({1024, 1024, 1024})
+	->Args({2048, 512, 2048})
+	->Args({512, 2048, 512})
+	->Args({2048, 2048, 2048})
+	->Args({4096, 1024, 4096})
+	->Args({1024, 4096, 1024});
+
+// Cache-oblivious parallel multiplication, varying thread counts
+
+BENCHMARK(BM_multiply_threads)
+	->ArgsProduct({{2048}, {2048}, {2048}, {1, 2, 4, 8, 16}})
+	->ArgsProduct({{4096}, {1024}, {4096}, {1, 2, 4, 8, 16}})
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
+
 // Naive multiplication, varying types
 
 BENCHMARK_TEMPLATE(BM_naive_multiply_types, std::int8_t)->Args({256, 256, 256});
@@ -338,6 +1217,14 @@ BENCHMARK_TEMPLATE(BM_naive_multiply_types, std::int64_t)->Args({256, 256, 256})
 BENCHMARK_TEMPLATE(BM_naive_multiply_types, std::int64_t)->Args({1024, 64, 1024});
 BENCHMARK_TEMPLATE(BM_naive_multiply_types, std::int64_t)->Args({64, 1024, 64});
 
+BENCHMARK_TEMPLATE(BM_naive_multiply_types, float)->Args({256, 256, 256});
+BENCHMARK_TEMPLATE(BM_naive_multiply_types, float)->Args({1024, 64, 1024});
+BENCHMARK_TEMPLATE(BM_naive_multiply_types, float)->Args({64, 1024, 64});
+
+BENCHMARK_TEMPLATE(BM_naive_multiply_types, double)->Args({256, 256, 256});
+BENCHMARK_TEMPLATE(BM_naive_multiply_types, double)->Args({1024, 64, 1024});
+BENCHMARK_TEMPLATE(BM_naive_multiply_types, double)->Args({64, 1024, 64});
+
 BENCHMARK_TEMPLATE(BM_naive_multiply_types, std::complex<std::int8_t>)->Args({256, 256, 256});
 BENCHMARK_TEMPLATE(BM_naive_multiply_types, std::complex<std::int8_t>)->Args({1024, 64, 1024});
 BENCHMARK_TEMPLATE(BM_naive_multiply_types, std::complex<std::int8_t>)->Args({64, 1024, 64});
@@ -372,6 +1259,14 @@ BENCHMARK_TEMPLATE(BM_multiply_types, std::int64_t)->Args({256, 256, 256});
 BENCHMARK_TEMPLATE(BM_multiply_types, std::int64_t)->Args({1024, 64, 1024});
 BENCHMARK_TEMPLATE(BM_multiply_types, std::int64_t)->Args({64, 1024, 64});
 
+BENCHMARK_TEMPLATE(BM_multiply_types, float)->Args({256, 256, 256});
+BENCHMARK_TEMPLATE(BM_multiply_types, float)->Args({1024, 64, 1024});
+BENCHMARK_TEMPLATE(BM_multiply_types, float)->Args({64, 1024, 64});
+
+BENCHMARK_TEMPLATE(BM_multiply_types, double)->Args({256, 256, 256});
+BENCHMARK_TEMPLATE(BM_multiply_types, double)->Args({1024, 64, 1024});
+BENCHMARK_TEMPLATE(BM_multiply_types, double)->Args({64, 1024, 64});
+
 BENCHMARK_TEMPLATE(BM_multiply_types, std::complex<std::int8_t>)->Args({256, 256, 256});
 BENCHMARK_TEMPLATE(BM_multiply_types, std::complex<std::int8_t>)->Args({1024, 64, 1024});
 BENCHMARK_TEMPLATE(BM_multiply_types, std::complex<std::int8_t>)->Args({64, 1024, 64});
@@ -388,6 +1283,101 @@ BENCHMARK_TEMPLATE(BM_multiply_types, std::complex<std::int64_t>)->Args({256, 25
 BENCHMARK_TEMPLATE(BM_multiply_types, std::complex<std::int64_t>)->Args({1024, 64, 1024});
 BENCHMARK_TEMPLATE(BM_multiply_types, std::complex<std::int64_t>)->Args({64, 1024, 64});
 
+// Cache-oblivious multiplication, widening accumulation
+
+BENCHMARK_TEMPLATE(BM_widening_multiply_types, std::int8_t, std::int32_t)->Args({256, 256, 256});
+BENCHMARK_TEMPLATE(BM_widening_multiply_types, std::int8_t, std::int32_t)->Args({1024, 64, 1024});
+BENCHMARK_TEMPLATE(BM_widening_multiply_types, std::int8_t, std::int32_t)->Args({64, 1024, 64});
+BENCHMARK_TEMPLATE(BM_widening_multiply_types, std::int8_t, std::int32_t)->Args({1024, 1024, 1024});
+
+BENCHMARK_TEMPLATE(BM_widening_multiply_types, std::int16_t, std::int32_t)->Args({256, 256, 256});
+BENCHMARK_TEMPLATE(BM_widening_multiply_types, std::int16_t, std::int32_t)->Args({1024, 64, 1024});
+BENCHMARK_TEMPLATE(BM_widening_multiply_types, std::int16_t, std::int32_t)->Args({64, 1024, 64});
+BENCHMARK_TEMPLATE(BM_widening_multiply_types, std::int16_t, std::int32_t)->Args({1024, 1024, 1024});
+
+BENCHMARK_TEMPLATE(BM_widening_multiply_types, std::int16_t, std::int64_t)->Args({256, 256, 256});
+BENCHMARK_TEMPLATE(BM_widening_multiply_types, std::int16_t, std::int64_t)->Args({1024, 64, 1024});
+BENCHMARK_TEMPLATE(BM_widening_multiply_types, std::int16_t, std::int64_t)->Args({64, 1024, 64});
+BENCHMARK_TEMPLATE(BM_widening_multiply_types, std::int16_t, std::int64_t)->Args({1024, 1024, 1024});
+
+BENCHMARK_TEMPLATE(BM_widening_multiply_types, std::int8_t, std::int64_t)->Args({256, 256, 256});
+BENCHMARK_TEMPLATE(BM_widening_multiply_types, std::int8_t, std::int64_t)->Args({1024, 64, 1024});
+BENCHMARK_TEMPLATE(BM_widening_multiply_types, std::int8_t, std::int64_t)->Args({64, 1024, 64});
+BENCHMARK_TEMPLATE(BM_widening_multiply_types, std::int8_t, std::int64_t)->Args({1024, 1024, 1024});
+
+// Strassen-Winograd against the classical recursion, large sizes
+
+BENCHMARK_TEMPLATE(BM_multiply_types, std::int32_t)->Args({2048, 2048, 2048})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_multiply_types, std::int32_t)->Args({3000, 3000, 3000})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_multiply_types, std::int32_t)->Args({4096, 4096, 4096})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_strassen_multiply_types, std::int32_t)->Args({2048, 2048, 2048})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_strassen_multiply_types, std::int32_t)->Args({3000, 3000, 3000})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_strassen_multiply_types, std::int32_t)->Args({4096, 4096, 4096})->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_multiply_types, float)->Args({2048, 2048, 2048})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_multiply_types, float)->Args({3000, 3000, 3000})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_multiply_types, float)->Args({4096, 4096, 4096})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_strassen_multiply_types, float)->Args({2048, 2048, 2048})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_strassen_multiply_types, float)->Args({3000, 3000, 3000})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_strassen_multiply_types, float)->Args({4096, 4096, 4096})->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_multiply_types, double)->Args({2048, 2048, 2048})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_multiply_types, double)->Args({3000, 3000, 3000})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_multiply_types, double)->Args({4096, 4096, 4096})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_strassen_multiply_types, double)->Args({2048, 2048, 2048})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_strassen_multiply_types, double)->Args({3000, 3000, 3000})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_strassen_multiply_types, double)->Args({4096, 4096, 4096})->Unit(benchmark::kMillisecond);
+
+// General matrix multiply against explicit transposes and scaling
+
+BENCHMARK(BM_gemm)
+	->ArgsProduct({{1024, 2048}, {64, 1024}, {1024, 2048}, {0, 1}, {0, 1}})
+	->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_gemm_explicit)
+	->ArgsProduct({{1024, 2048}, {64, 1024}, {1024, 2048}, {0, 1}, {0, 1}})
+	->Unit(benchmark::kMillisecond);
+
+/* Morton Order */
+
+// Kernel alone (0) and including conversion from and to row-major (1)
+
+BENCHMARK(BM_morton_transpose)
+	->ArgsProduct({{500, 1000, 5000}, {500, 1000, 5000}, {0, 1}});
+
+BENCHMARK(BM_morton_multiply)
+	->ArgsProduct({{256, 1024, 2048}, {256, 1024, 2048}, {256, 1024, 2048}, {0, 1}})
+	->Unit(benchmark::kMillisecond);
+
+/* Dense Factorizations */
+
+BENCHMARK(BM_naive_lu)->RangeMultiplier(2)->Range(256, 2048)
+	->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_lu)->RangeMultiplier(2)->Range(256, 2048)
+	->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_naive_cholesky)->RangeMultiplier(2)->Range(256, 2048)
+	->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_cholesky)->RangeMultiplier(2)->Range(256, 2048)
+	->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_naive_triangular_solve)
+	->ArgsProduct({{256, 1024, 2048}, {64, 1024, 2048}})
+	->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_triangular_solve)
+	->ArgsProduct({{256, 1024, 2048}, {64, 1024, 2048}})
+	->Unit(benchmark::kMillisecond);
+
+/* Batched Small Matrices */
+
+BENCHMARK(BM_batched_transpose)
+	->ArgsProduct({{16, 256, 4096}, {8, 16, 32, 64}, {0, 1, 4}})
+	->UseRealTime();
+
+BENCHMARK(BM_batched_multiply)
+	->ArgsProduct({{16, 256, 4096}, {8, 16, 32, 64}, {0, 1, 4}})
+	->UseRealTime();
+
 /* Fast Fourier Transform */
 
 // Naive FFT, varying sizes
@@ -401,7 +1391,18 @@ BENCHMARK(BM_naive_fft)
 	->Args({8 << 15})
 	->Args({8 << 18});
 
-// Cache-oblivious FFT, varying types
+// Recursive radix-2 FFT, varying sizes
+
+BENCHMARK(BM_dit_fft)
+	->Args({8})
+	->Args({8 << 3})
+	->Args({8 << 6})
+	->Args({8 << 9})
+	->Args({8 << 12})
+	->Args({8 << 15})
+	->Args({8 << 18});
+
+// Cache-oblivious FFT, varying sizes
 
 BENCHMARK(BM_fft)
 	->Args({8})
@@ -412,6 +1413,62 @@ BENCHMARK(BM_fft)
 	->Args({8 << 15})
 	->Args({8 << 18});
 
+// Cache-oblivious FFT with a reused plan, varying sizes
+
+BENCHMARK(BM_fft_plan)
+	->Args({8})
+	->Args({8 << 3})
+	->Args({8 << 6})
+	->Args({8 << 9})
+	->Args({8 << 12})
+	->Args({8 << 15})
+	->Args({8 << 18});
+
+// Twiddles applied per row against a separate twiddle pass, varying sizes
+
+BENCHMARK(BM_fft_twiddle_rows)
+	->Args({8})
+	->Args({8 << 3})
+	->Args({8 << 6})
+	->Args({8 << 9})
+	->Args({8 << 12})
+	->Args({8 << 15})
+	->Args({8 << 18});
+
+BENCHMARK(BM_fft_twiddle_pass)
+	->Args({8})
+	->Args({8 << 3})
+	->Args({8 << 6})
+	->Args({8 << 9})
+	->Args({8 << 12})
+	->Args({8 << 15})
+	->Args({8 << 18});
+
+// Lengths other than powers of two: mixed radix with 3, 5 and 7, small
+// primes below and above the Bluestein threshold, and large primes
+
+BENCHMARK(BM_fft)
+	->Args({3 << 10})
+	->Args({5 << 10})
+	->Args({7 << 10})
+	->Args({3 << 18})
+	->Args({61})
+	->Args({67})
+	->Args({4099})
+	->Args({65537})
+	->Args({1000003});
+
+BENCHMARK(BM_fft_plan)
+	->Args({3 << 10})
+	->Args({5 << 10})
+	->Args({7 << 10})
+	->Args({3 << 18})
+	->Args({61})
+	->Args({67})
+	->Args({4099})
+	->Args({65537})
+	->Args({1000003});
+
 // Naive FFT, varying types
 
 BENCHMARK_TEMPLATE(BM_naive_fft_types, std::int8_t)->Args({4096});
@@ -428,4 +1485,108 @@ BENCHMARK_TEMPLATE(BM_fft_types, std::int32_t)->Args({4096});
 BENCHMARK_TEMPLATE(BM_fft_types, std::int64_t)->Args({4096});
 BENCHMARK_TEMPLATE(BM_fft_types, long double)->Args({4096});
 
+// Cache-oblivious parallel FFT, varying thread counts
+
+BENCHMARK(BM_fft_threads)
+	->ArgsProduct({{1 << 21, 1 << 23}, {1, 2, 4, 8, 16}})
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
+
+// Interleaved against split layout, varying sizes
+
+BENCHMARK_TEMPLATE(BM_fft_interleaved, float)
+	->Args({8})
+	->Args({8 << 3})
+	->Args({8 << 6})
+	->Args({8 << 9})
+	->Args({8 << 12})
+	->Args({8 << 15})
+	->Args({8 << 18});
+BENCHMARK_TEMPLATE(BM_fft_split, float)
+	->Args({8})
+	->Args({8 << 3})
+	->Args({8 << 6})
+	->Args({8 << 9})
+	->Args({8 << 12})
+	->Args({8 << 15})
+	->Args({8 << 18});
+BENCHMARK_TEMPLATE(BM_fft_interleaved, double)
+	->Args({8})
+	->Args({8 << 3})
+	->Args({8 << 6})
+	->Args({8 << 9})
+	->Args({8 << 12})
+	->Args({8 << 15})
+	->Args({8 << 18});
+BENCHMARK_TEMPLATE(BM_fft_split, double)
+	->Args({8})
+	->Args({8 << 3})
+	->Args({8 << 6})
+	->Args({8 << 9})
+	->Args({8 << 12})
+	->Args({8 << 15})
+	->Args({8 << 18});
+
+// Real to complex against the complex path, and complex to real
+
+BENCHMARK_TEMPLATE(BM_real_fft, float)
+	->RangeMultiplier(8)
+	->Range(1 << 9, 1 << 21);
+BENCHMARK_TEMPLATE(BM_real_fft, double)
+	->RangeMultiplier(8)
+	->Range(1 << 9, 1 << 21);
+BENCHMARK_TEMPLATE(BM_real_fft_complex_path, float)
+	->RangeMultiplier(8)
+	->Range(1 << 9, 1 << 21);
+BENCHMARK_TEMPLATE(BM_real_fft_complex_path, double)
+	->RangeMultiplier(8)
+	->Range(1 << 9, 1 << 21);
+BENCHMARK_TEMPLATE(BM_real_inverse_fft, double)
+	->RangeMultiplier(8)
+	->Range(1 << 9, 1 << 21);
+
+// Multidimensional FFT, square 2D up to 8192 x 8192 and cubic 3D
+
+BENCHMARK_TEMPLATE(BM_naive_fft_2d, float)
+	->RangeMultiplier(4)
+	->Range(256, 8192)
+	->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_fft_2d, float)
+	->RangeMultiplier(4)
+	->Range(256, 8192)
+	->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_fft_3d, float)
+	->RangeMultiplier(4)
+	->Range(16, 256)
+	->Unit(benchmark::kMillisecond);
+
+/* Out-of-core Fast Fourier Transform */
+
+// Out-of-core FFT of cold complex<float> files from 128 MiB to 4 GiB,
+// varying the memory budget
+
+BENCHMARK(BM_fft_file)
+	->Args({1 << 24, 16})
+	->Args({1 << 24, 64})
+	->Args({1 << 27, 64})
+	->Args({1 << 28, 64})
+	->Args({1 << 28, 256})
+	->Args({1 << 29, 256})
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
+
+/* Convolution */
+
+// Direct against overlap-save convolution of 2^16 values, varying kernel
+// lengths. The crossover is where BM_convolve overtakes BM_naive_convolve.
+
+BENCHMARK_TEMPLATE(BM_naive_convolve, float)
+	->ArgsProduct({{1 << 16}, {4, 8, 16, 32, 64, 128, 256, 1024, 4096}});
+BENCHMARK_TEMPLATE(BM_convolve, float)
+	->ArgsProduct({{1 << 16}, {4, 8, 16, 32, 64, 128, 256, 1024, 4096}});
+BENCHMARK_TEMPLATE(BM_naive_convolve, double)
+	->ArgsProduct({{1 << 16}, {4, 8, 16, 32, 64, 128, 256, 1024, 4096}});
+BENCHMARK_TEMPLATE(BM_convolve, double)
+	->ArgsProduct({{1 << 16}, {4, 8, 16, 32, 64, 128, 256, 1024, 4096}});
+
 BENCHMARK_MAIN();
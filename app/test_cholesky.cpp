@@ -0,0 +1,89 @@
+#define CATCH_CONFIG_MAIN
+
+#include <ra/cholesky.hpp>
+
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+
+using namespace ra::cache;
+
+template <class T> T tolerance() { return sizeof(T) == 4 ? 1e-3 : 1e-9; }
+
+TEST_CASE("Naive Cholesky factorization.") {
+  double a[] = {4, 0, 0, 2, 10, 0, -2, 5, 9};
+  REQUIRE(naive_cholesky_factor(a, 3, 3));
+  double expected[] = {2, 0, 0, 1, 3, 0, -1, 2, 2};
+  for (std::size_t i = 0; i < 9; ++i) {
+    REQUIRE(a[i] == Approx(expected[i]).margin(1e-12));
+  }
+}
+
+TEMPLATE_TEST_CASE("Cholesky factorization.", "", float, double) {
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<TestType> dis(-1, 1);
+  std::size_t sizes[] = {1, 37, 150};
+  // Row length wider than the matrices, as for blocks of larger ones
+  std::size_t ld = 170;
+  for (std::size_t n : sizes) {
+    // m m^T + n I is symmetric positive definite and well conditioned
+    auto m = std::make_unique<TestType[]>(n * n);
+    std::generate_n(m.get(), n * n, [&] { return dis(rng); });
+    auto a = std::make_unique<TestType[]>(n * n);
+    naive_gemm(matrix_op::none, matrix_op::transpose, n, n, n, TestType(1),
+               m.get(), n, m.get(), n, TestType(0), a.get(), n);
+    for (std::size_t i = 0; i < n; ++i) {
+      a[i * n + i] += TestType(n);
+    }
+
+    // The strictly upper triangle holds NaN, which must be neither read
+    // nor overwritten
+    auto b = std::make_unique<TestType[]>(n * ld);
+    for (std::size_t i = 0; i < n; ++i) {
+      for (std::size_t j = 0; j < ld; ++j) {
+        b[i * ld + j] = j <= i ? a[i * n + j]
+                               : std::numeric_limits<TestType>::quiet_NaN();
+      }
+    }
+    auto c = std::make_unique<TestType[]>(n * ld);
+    auto d = std::make_unique<TestType[]>(n * ld);
+    std::copy_n(b.get(), n * ld, c.get());
+    std::copy_n(b.get(), n * ld, d.get());
+    REQUIRE(naive_cholesky_factor(b.get(), ld, n));
+    REQUIRE(cholesky_factor(c.get(), ld, n));
+    REQUIRE(cholesky_factor<TestType, 8>(d.get(), ld, n));
+
+    TestType eps = tolerance<TestType>();
+    for (TestType *l : {b.get(), c.get(), d.get()}) {
+      for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = 0; j < ld; ++j) {
+          if (j > i) {
+            REQUIRE(std::isnan(l[i * ld + j]));
+            continue;
+          }
+          if (j < n) {
+            TestType sum(0);
+            for (std::size_t k = 0; k <= j; ++k) {
+              sum += l[i * ld + k] * l[j * ld + k];
+            }
+            REQUIRE(sum == Approx(a[i * n + j]).epsilon(eps).margin(eps));
+          }
+        }
+      }
+    }
+  }
+
+  SECTION("Not positive definite.") {
+    std::size_t n = 100;
+    auto a = std::make_unique<TestType[]>(n * n);
+    for (std::size_t i = 0; i < n; ++i) {
+      a[i * n + i] = 1;
+    }
+    a[80 * n + 80] = -1;
+    REQUIRE(!cholesky_factor<TestType, 8>(a.get(), n, n));
+    REQUIRE(!naive_cholesky_factor(a.get(), n, n));
+  }
+}
@@ -0,0 +1,97 @@
+#define CATCH_CONFIG_MAIN
+
+#include <ra/convolution.hpp>
+
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <complex>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using namespace ra::cache;
+
+template <class T>
+std::vector<T> random_signal(std::mt19937 &rng, std::size_t n) {
+  std::uniform_real_distribution<T> dis(-1, 1);
+  std::vector<T> x(n);
+  std::generate(x.begin(), x.end(), [&] { return dis(rng); });
+  return x;
+}
+
+TEST_CASE("Naive convolution and correlation.") {
+  double a[] = {1, 2, 3};
+  double b[] = {1, -1};
+  double y[4];
+  naive_convolve(a, 3, b, 2, y);
+  double convolution[] = {1, 1, 1, -3};
+  for (std::size_t i = 0; i < 4; ++i) {
+    REQUIRE(y[i] == convolution[i]);
+  }
+  naive_correlate(a, 3, b, 2, y);
+  double correlation[] = {-1, -1, -1, 3};
+  for (std::size_t i = 0; i < 4; ++i) {
+    REQUIRE(y[i] == correlation[i]);
+  }
+}
+
+TEMPLATE_TEST_CASE("FFT convolution.", "", float, double) {
+  using C = std::complex<TestType>;
+  double eps = sizeof(TestType) == 4 ? 1e-3 : 1e-9;
+  std::mt19937 rng(42);
+  // Signals shorter and longer than a block, kernels of one value and
+  // longer than the signal
+  std::pair<std::size_t, std::size_t> shapes[] = {
+      {1, 1}, {10, 1}, {100, 7}, {1000, 33}, {5000, 100}, {20, 300}};
+  for (auto [n, m] : shapes) {
+    auto a = random_signal<TestType>(rng, n);
+    auto b = random_signal<TestType>(rng, m);
+    std::vector<TestType> expected(n + m - 1);
+    std::vector<TestType> y(n + m - 1);
+
+    naive_convolve(a.data(), n, b.data(), m, expected.data());
+    fft_convolve<C>(a.data(), n, b.data(), m, y.data());
+    for (std::size_t i = 0; i < n + m - 1; ++i) {
+      REQUIRE(y[i] == Approx(expected[i]).margin(eps));
+    }
+
+    naive_correlate(a.data(), n, b.data(), m, expected.data());
+    fft_correlate<C>(a.data(), n, b.data(), m, y.data());
+    for (std::size_t i = 0; i < n + m - 1; ++i) {
+      REQUIRE(y[i] == Approx(expected[i]).margin(eps));
+    }
+  }
+
+  SECTION("Reused across signals, with a given block size.") {
+    std::size_t m = 50;
+    auto b = random_signal<TestType>(rng, m);
+    convolver<C> filter(b.data(), m, filter_mode::convolution, 100);
+    REQUIRE(filter.kernel_size() == m);
+    REQUIRE(filter.block_size() == 128);
+    for (std::size_t n : {1, 79, 80, 1000}) {
+      auto a = random_signal<TestType>(rng, n);
+      std::vector<TestType> expected(n + m - 1);
+      std::vector<TestType> y(n + m - 1);
+      naive_convolve(a.data(), n, b.data(), m, expected.data());
+      filter.filter(a.data(), n, y.data());
+      for (std::size_t i = 0; i < n + m - 1; ++i) {
+        REQUIRE(y[i] == Approx(expected[i]).margin(eps));
+      }
+    }
+  }
+
+  SECTION("Empty operands.") {
+    auto a = random_signal<TestType>(rng, 10);
+    // Canary values that must not be overwritten
+    std::vector<TestType> y(10, TestType(7));
+    fft_convolve<C>(a.data(), 10, a.data(), 0, y.data());
+    fft_convolve<C>(a.data(), 0, a.data(), 10, y.data());
+    fft_correlate<C>(a.data(), 10, a.data(), 0, y.data());
+    fft_correlate<C>(a.data(), 0, a.data(), 10, y.data());
+    for (TestType v : y) {
+      REQUIRE(v == TestType(7));
+    }
+    REQUIRE_THROWS_AS(convolver<C>(a.data(), 0), std::invalid_argument);
+  }
+}
@@ -1,11 +1,19 @@
 #define CATCH_CONFIG_MAIN
 
+#include <unistd.h>
+
 #include <catch2/catch.hpp>
 #include <complex>
+#include <filesystem>
+#include <fstream>
 #include <memory>
 #include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 #include "ra/fft.hpp"
+#include "ra/mapped_fft.hpp"
 
 using namespace ra::cache;
 
@@ -26,6 +34,22 @@ std::unique_ptr<T[]> copy_vector(const T* v, std::size_t n) {
 	return copy;
 }
 
+// DFT of n elements in long double by the definition
+template <class T>
+std::vector<std::complex<long double>> direct_dft(const T* x, std::size_t n) {
+	std::vector<std::complex<long double>> roots(n);
+	for (std::size_t k = 0; k < n; ++k) {
+		roots[k] = std::polar(1.0L, -2 * pi<long double> * k / n);
+	}
+	std::vector<std::complex<long double>> res(n);
+	for (std::size_t k = 0; k < n; ++k) {
+		for (std::size_t i = 0; i < n; ++i) {
+			res[k] += std::complex<long double>(x[i]) * roots[k * i % n];
+		}
+	}
+	return res;
+}
+
 TEST_CASE("Naive FFT.") {
   SECTION("Two elements.") {
 		auto x = generate_random_vector<std::complex<double>>(2);
@@ -98,3 +122,362 @@ TEST_CASE("Cache oblivious FFT.") {
 		check_vector_equal(x.get(), expected.get(), 4096);
   }
 }
+
+TEST_CASE("Cache oblivious FFT, varying leaf sizes.") {
+	auto x = generate_random_vector<std::complex<double>>(1024);
+	auto expected = copy_vector(x.get(), 1024);
+	naive_fft<std::complex<double>>(expected.get(), 1024);
+
+  SECTION("Leaf of 2.") {
+		forward_fft<std::complex<double>, 2>(x.get(), 1024);
+		check_vector_equal(x.get(), expected.get(), 1024);
+  }
+
+  SECTION("Leaf of 32.") {
+		forward_fft<std::complex<double>, 32>(x.get(), 1024);
+		check_vector_equal(x.get(), expected.get(), 1024);
+  }
+}
+
+TEST_CASE("FFT plan.") {
+	SECTION("Reused across transforms.") {
+		fft_plan<std::complex<double>> plan(1024);
+		REQUIRE(plan.size() == 1024);
+		for (int seed = 0; seed < 3; ++seed) {
+			auto x = generate_random_vector<std::complex<double>>(1024, seed);
+			auto expected = copy_vector(x.get(), 1024);
+			plan.forward(x.get());
+			naive_fft<std::complex<double>>(expected.get(), 1024);
+			check_vector_equal(x.get(), expected.get(), 1024);
+		}
+	}
+
+	SECTION("Matches a direct DFT in higher precision.") {
+		// Twiddles from tables rather than repeated powers keep the error
+		// near the rounding of the result
+		std::size_t n = 4096;
+		auto x = generate_random_vector<std::complex<double>>(n);
+		std::vector<std::complex<long double>> expected(n);
+		for (std::size_t k = 0; k < n; ++k) {
+			for (std::size_t i = 0; i < n; ++i) {
+				long double angle = -2 * pi<long double> * (k * i % n) / n;
+				expected[k] += std::complex<long double>(x[i]) * std::polar(1.0L, angle);
+			}
+		}
+		fft_plan<std::complex<double>, 2>(n).forward(x.get());
+		for (std::size_t k = 0; k < n; ++k) {
+			REQUIRE(std::abs(std::complex<long double>(x[k]) - expected[k]) < 1e-6);
+		}
+	}
+
+	SECTION("Roots of unity.") {
+		fft_plan<std::complex<double>> plan(8);
+		REQUIRE(plan.roots()[0].real() == Approx(1));
+		REQUIRE(plan.roots()[2].imag() == Approx(-1));
+		REQUIRE(plan.roots()[4].real() == Approx(-1));
+	}
+}
+
+TEST_CASE("Inverse FFT.") {
+	for (std::size_t n : {1, 2, 12, 256, 1009}) {
+		std::mt19937 rng(n);
+		std::uniform_real_distribution<double> dis(-1, 1);
+		std::vector<std::complex<double>> x(n);
+		for (auto& v : x) {
+			v = {dis(rng), dis(rng)};
+		}
+		auto y = x;
+		fft_plan<std::complex<double>> plan(n);
+		plan.forward(y.data());
+		plan.inverse(y.data());
+		for (std::size_t i = 0; i < n; ++i) {
+			REQUIRE(std::abs(y[i] - x[i]) < 1e-12);
+		}
+		forward_fft(y.data(), n);
+		inverse_fft(y.data(), n);
+		for (std::size_t i = 0; i < n; ++i) {
+			REQUIRE(std::abs(y[i] - x[i]) < 1e-12);
+		}
+	}
+}
+
+TEST_CASE("Iterative FFT.") {
+	// Odd and even powers of two take the radix-2 pass or not
+	for (std::size_t n = 1; n <= 8192; n *= 2) {
+		auto x = generate_random_vector<std::complex<double>>(n);
+		auto expected = copy_vector(x.get(), n);
+		iterative_fft(x.get(), n);
+		std::unique_ptr<std::complex<double>[]> res(dit_fft(expected.get(), n));
+		for (std::size_t i = 0; i < n; ++i) {
+			REQUIRE(x[i].real() == Approx(res[i].real()).margin(1e-6));
+			REQUIRE(x[i].imag() == Approx(res[i].imag()).margin(1e-6));
+		}
+	}
+}
+
+TEST_CASE("Arbitrary length FFT.") {
+	// Codelet lengths, their products and powers, primes on either side of
+	// the Bluestein threshold and mixed radix lengths with large factors
+	std::size_t sizes[] = {1, 3, 5, 6, 7, 9, 11, 12, 15, 30, 49, 61, 96, 100,
+	                       127, 210, 251, 257, 1009, 1155, 3072, 3584, 5120,
+	                       4099};
+	for (std::size_t n : sizes) {
+		auto x = generate_random_vector<std::complex<double>>(n);
+		auto expected = direct_dft(x.get(), n);
+		auto y = copy_vector(x.get(), n);
+		auto z = copy_vector(x.get(), n);
+		forward_fft<std::complex<double>>(x.get(), n);
+		forward_fft<std::complex<double>, 2>(y.get(), n);
+		naive_fft<std::complex<double>>(z.get(), n);
+		// Inputs are up to 1e6 in magnitude
+		double eps = 1e-6 * std::sqrt(double(n));
+		for (std::size_t k = 0; k < n; ++k) {
+			REQUIRE(std::abs(std::complex<long double>(x[k]) - expected[k]) < eps);
+			REQUIRE(std::abs(std::complex<long double>(y[k]) - expected[k]) < eps);
+			REQUIRE(std::abs(std::complex<long double>(z[k]) - expected[k]) < eps);
+		}
+	}
+}
+
+TEST_CASE("Real FFT.") {
+	std::size_t sizes[] = {1, 2, 3, 4, 6, 8, 10, 15, 64, 96, 100, 1009, 1024,
+	                       3072};
+	for (std::size_t n : sizes) {
+		auto v = generate_random_vector<std::complex<double>>(n);
+		std::vector<double> x(n);
+		for (std::size_t i = 0; i < n; ++i) {
+			x[i] = v[i].real();
+		}
+		auto expected = direct_dft(x.data(), n);
+
+		std::size_t m = n / 2 + 1;
+		std::vector<std::complex<double>> y(m);
+		std::vector<std::complex<double>> z(m);
+		forward_real_fft(x.data(), n, y.data());
+		real_fft_plan<std::complex<double>, 2> plan(n);
+		REQUIRE(plan.size() == n);
+		plan.forward(x.data(), z.data());
+		double eps = 1e-6 * std::sqrt(double(n));
+		for (std::size_t k = 0; k < m; ++k) {
+			REQUIRE(std::abs(std::complex<long double>(y[k]) - expected[k]) < eps);
+			REQUIRE(std::abs(std::complex<long double>(z[k]) - expected[k]) < eps);
+		}
+
+		// The inverse recovers the input
+		std::vector<double> r(n);
+		std::vector<double> s(n);
+		inverse_real_fft(y.data(), n, r.data());
+		plan.inverse(z.data(), s.data());
+		for (std::size_t i = 0; i < n; ++i) {
+			REQUIRE(r[i] == Approx(x[i]).margin(1e-6));
+			REQUIRE(s[i] == Approx(x[i]).margin(1e-6));
+		}
+	}
+}
+
+// Transforms the array at x with the given dimensions along one axis by
+// gathering each line into a vector
+template <class T>
+void axis_fft(T* x, const std::vector<std::size_t>& dims, std::size_t axis) {
+	std::size_t stride = 1;
+	for (std::size_t a = axis + 1; a < dims.size(); ++a) {
+		stride *= dims[a];
+	}
+	std::size_t n = dims[axis];
+	std::size_t outer = 1;
+	for (std::size_t a = 0; a < axis; ++a) {
+		outer *= dims[a];
+	}
+	std::vector<T> line(n);
+	for (std::size_t o = 0; o < outer; ++o) {
+		for (std::size_t s = 0; s < stride; ++s) {
+			T* first = x + o * n * stride + s;
+			for (std::size_t i = 0; i < n; ++i) {
+				line[i] = first[i * stride];
+			}
+			naive_fft(line.data(), n);
+			for (std::size_t i = 0; i < n; ++i) {
+				first[i * stride] = line[i];
+			}
+		}
+	}
+}
+
+TEST_CASE("Multidimensional FFT.") {
+	std::vector<std::size_t> shapes[] = {
+		{1, 1}, {4, 8}, {8, 4}, {6, 10}, {16, 16}, {3, 5}, {0, 8},
+		{2, 3, 4}, {8, 4, 16}, {5, 1, 7}, {16, 16, 16}, {4, 0, 3}};
+	for (const auto& dims : shapes) {
+		std::size_t size = 1;
+		for (std::size_t d : dims) {
+			size *= d;
+		}
+		auto x = generate_random_vector<std::complex<double>>(size);
+		auto original = copy_vector(x.get(), size);
+		auto expected = copy_vector(x.get(), size);
+		for (std::size_t a = 0; a < dims.size(); ++a) {
+			axis_fft(expected.get(), dims, a);
+		}
+
+		auto y = copy_vector(x.get(), size);
+		multi_fft_plan<std::complex<double>, 2> plan(dims);
+		REQUIRE(plan.size() == size);
+		if (dims.size() == 2) {
+			forward_fft_2d(x.get(), dims[0], dims[1]);
+		} else {
+			forward_fft_3d(x.get(), dims[0], dims[1], dims[2]);
+		}
+		plan.forward(y.get());
+		for (std::size_t i = 0; i < size; ++i) {
+			REQUIRE(std::abs(x[i] - expected[i]) < 1e-6 * size);
+			REQUIRE(std::abs(y[i] - expected[i]) < 1e-6 * size);
+		}
+
+		if (dims.size() == 2) {
+			inverse_fft_2d(x.get(), dims[0], dims[1]);
+		} else {
+			inverse_fft_3d(x.get(), dims[0], dims[1], dims[2]);
+		}
+		plan.inverse(y.get());
+		for (std::size_t i = 0; i < size; ++i) {
+			REQUIRE(std::abs(x[i] - original[i]) < 1e-6);
+			REQUIRE(std::abs(y[i] - original[i]) < 1e-6);
+		}
+	}
+}
+
+TEMPLATE_TEST_CASE("Split complex FFT.", "", float, double) {
+	using C = std::complex<TestType>;
+	double eps = sizeof(TestType) == 4 ? 1e-5 : 1e-12;
+	// Lengths handled by the iterative passes alone, by the six-step
+	// recursion above them and by the interleaved fallback
+	std::size_t sizes[] = {1, 2, 4, 8, 16, 64, 1000, 1024, 4096, 8192};
+	for (std::size_t n : sizes) {
+		auto x = generate_random_vector<C>(n);
+		auto expected = direct_dft(x.get(), n);
+		// Inputs are up to 1e6 in magnitude, outputs up to sqrt(n) times that
+		double scale = 1e6 * std::sqrt(double(n));
+
+		std::vector<TestType> re(n);
+		std::vector<TestType> im(n);
+		std::vector<TestType> re_small(n);
+		std::vector<TestType> im_small(n);
+		deinterleave(x.get(), n, re.data(), im.data());
+		deinterleave(x.get(), n, re_small.data(), im_small.data());
+		split_fft_plan<TestType> plan(n);
+		split_fft_plan<TestType, 8> small_leaf(n);
+		REQUIRE(plan.size() == n);
+		plan.forward(re.data(), im.data());
+		small_leaf.forward(re_small.data(), im_small.data());
+		for (std::size_t k = 0; k < n; ++k) {
+			std::complex<long double> y(re[k], im[k]);
+			std::complex<long double> z(re_small[k], im_small[k]);
+			REQUIRE(std::abs(y - expected[k]) < eps * scale);
+			REQUIRE(std::abs(z - expected[k]) < eps * scale);
+		}
+
+		plan.inverse(re.data(), im.data());
+		std::vector<C> y(n);
+		interleave(re.data(), im.data(), n, y.data());
+		for (std::size_t i = 0; i < n; ++i) {
+			REQUIRE(std::abs(y[i] - x[i]) < eps * 1e6);
+		}
+	}
+}
+
+TEST_CASE("Parallel FFT.") {
+	thread_pool pool(4);
+	// Small grains split the six-step levels of modest lengths across
+	// threads, down to the nested ones
+	std::size_t sizes[] = {8, 1009, 3072, 4096, 1 << 16};
+	for (std::size_t n : sizes) {
+		auto x = generate_random_vector<std::complex<double>>(n);
+		auto expected = copy_vector(x.get(), n);
+		auto y = copy_vector(x.get(), n);
+		fft_plan<std::complex<double>> plan(n);
+		plan.forward(expected.get());
+		plan.forward(x.get(), pool, 64);
+		forward_fft(y.get(), n, 3);
+		check_vector_equal(x.get(), expected.get(), n);
+		check_vector_equal(y.get(), expected.get(), n);
+	}
+}
+
+TEST_CASE("FFT codelets.") {
+	// Every power of two codelet, and the prime ones, as the whole transform
+	std::size_t sizes[] = {2, 3, 4, 5, 7, 8, 16, 32, 64};
+	for (std::size_t n : sizes) {
+		auto x = generate_random_vector<std::complex<double>>(n);
+		auto expected = direct_dft(x.get(), n);
+		fft_plan<std::complex<double>, 64>(n).forward(x.get());
+		for (std::size_t k = 0; k < n; ++k) {
+			REQUIRE(std::abs(std::complex<long double>(x[k]) - expected[k]) < 1e-6);
+		}
+	}
+}
+
+TEST_CASE("Out-of-core FFT.") {
+	using C = std::complex<double>;
+	// Named by process, so that concurrent test runs do not share files
+	auto dir = std::filesystem::temp_directory_path();
+	std::string id = std::to_string(::getpid());
+	std::string in = (dir / ("ra_test_fft_in_" + id + ".bin")).string();
+	std::string out = (dir / ("ra_test_fft_out_" + id + ".bin")).string();
+	auto write_signal = [&](const C* x, std::size_t n) {
+		std::ofstream file(in, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(x), n * sizeof(C));
+	};
+
+	// Budgets of whole and partial column blocks once the plans are paid
+	// for, a length whose blocks have no square structure, and a budget
+	// that exactly holds the prime length with its plan
+	std::size_t prime = 1009 + fft_plan<C>::memory_size(1009);
+	std::pair<std::size_t, std::size_t> cases[] = {
+			{4096, 1024}, {3072, 1000}, {1 << 16, 4096}, {1 << 15, 3000},
+			{3 * 5 * 7 * 11 * 13, 2000}, {1009, prime}};
+	for (auto [n, budget] : cases) {
+		auto x = generate_random_vector<C>(n);
+		write_signal(x.get(), n);
+		forward_fft_file<C>(in, n, out, budget * sizeof(C));
+		fft_plan<C>(n).forward(x.get());
+		mapped_file result(out);
+		REQUIRE(result.size() == n * sizeof(C));
+		auto y = static_cast<const C*>(result.data());
+		double eps = 1e-6 * std::sqrt(double(n));
+		for (std::size_t k = 0; k < n; ++k) {
+			REQUIRE(std::abs(y[k] - x[k]) < eps);
+		}
+	}
+
+	// One byte less and the prime length no longer fits
+	REQUIRE_THROWS_AS(forward_fft_file<C>(in, 1009, out, prime * sizeof(C) - 1),
+	                  std::invalid_argument);
+	REQUIRE_THROWS_AS(forward_fft_file<C>(in, 1 << 20, out),
+	                  std::invalid_argument);
+	REQUIRE_THROWS_AS(
+			forward_fft_file<C>((dir / "ra_missing").string(), 16, out),
+			std::system_error);
+
+	// Other spellings of the input path must not truncate it
+	std::size_t n = 4096;
+	auto x = generate_random_vector<C>(n);
+	write_signal(x.get(), n);
+	std::string alias = (dir / "." / ("ra_test_fft_in_" + id + ".bin")).string();
+	std::string link = (dir / ("ra_test_fft_link_" + id + ".bin")).string();
+	std::filesystem::create_symlink(in, link);
+	REQUIRE_THROWS_AS(forward_fft_file<C>(in, n, in), std::invalid_argument);
+	REQUIRE_THROWS_AS(forward_fft_file<C>(in, n, alias), std::invalid_argument);
+	REQUIRE_THROWS_AS(forward_fft_file<C>(in, n, link), std::invalid_argument);
+	{
+		mapped_file kept(in);
+		REQUIRE(kept.size() == n * sizeof(C));
+		auto y = static_cast<const C*>(kept.data());
+		for (std::size_t k = 0; k < n; ++k) {
+			REQUIRE(y[k] == x[k]);
+		}
+	}
+
+	std::filesystem::remove(in);
+	std::filesystem::remove(out);
+	std::filesystem::remove(link);
+}
@@ -0,0 +1,138 @@
+#define CATCH_CONFIG_MAIN
+
+#include <ra/lu.hpp>
+
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <complex>
+#include <memory>
+#include <random>
+#include <utility>
+
+using namespace ra::cache;
+
+template <class T> struct real_type { using type = T; };
+template <class T> struct real_type<std::complex<T>> { using type = T; };
+
+template <class T> double tolerance() {
+  return sizeof(typename real_type<T>::type) == 4 ? 1e-3 : 1e-9;
+}
+
+template <class T> T random_element(std::mt19937 &rng) {
+  std::uniform_real_distribution<double> dis(-1, 1);
+  if constexpr (std::is_same_v<T, typename real_type<T>::type>) {
+    return T(dis(rng));
+  } else {
+    return T(dis(rng), dis(rng));
+  }
+}
+
+// Multiplies the factors held in lu back together and undoes the row swaps
+template <class T>
+std::unique_ptr<T[]> reconstruct(const T *lu, std::size_t m, std::size_t n,
+                                 const std::size_t *pivots) {
+  std::size_t k = std::min(m, n);
+  auto l = std::make_unique<T[]>(m * k);
+  auto u = std::make_unique<T[]>(k * n);
+  for (std::size_t i = 0; i < m; ++i) {
+    for (std::size_t j = 0; j < k; ++j) {
+      l[i * k + j] = j < i ? lu[i * n + j] : T(i == j);
+    }
+  }
+  for (std::size_t i = 0; i < k; ++i) {
+    for (std::size_t j = i; j < n; ++j) {
+      u[i * n + j] = lu[i * n + j];
+    }
+  }
+  auto a = std::make_unique<T[]>(m * n);
+  naive_matrix_multiply(l.get(), u.get(), m, k, n, a.get());
+  for (std::size_t i = k; i-- > 0;) {
+    std::swap_ranges(a.get() + i * n, a.get() + (i + 1) * n,
+                     a.get() + pivots[i] * n);
+  }
+  return a;
+}
+
+TEST_CASE("Naive LU factorization.") {
+  // The second row has the larger leading element and is swapped up
+  double a[] = {1, 2, 4, 6};
+  std::size_t pivots[2];
+  REQUIRE(naive_lu_factor(a, 2, 2, 2, pivots));
+  REQUIRE(pivots[0] == 1);
+  REQUIRE(pivots[1] == 1);
+  double expected[] = {4, 6, 0.25, 0.5};
+  for (std::size_t i = 0; i < 4; ++i) {
+    REQUIRE(a[i] == Approx(expected[i]));
+  }
+}
+
+TEMPLATE_TEST_CASE("LU factorization.", "", float, double,
+                   std::complex<double>) {
+  std::mt19937 rng(42);
+  std::pair<std::size_t, std::size_t> shapes[] = {
+      {200, 200}, {150, 90}, {90, 150}, {1, 70}, {70, 1}};
+  for (auto [m, n] : shapes) {
+    auto a = std::make_unique<TestType[]>(m * n);
+    std::generate_n(a.get(), m * n, [&] { return random_element<TestType>(rng); });
+
+    auto b = std::make_unique<TestType[]>(m * n);
+    auto c = std::make_unique<TestType[]>(m * n);
+    auto d = std::make_unique<TestType[]>(m * n);
+    std::copy_n(a.get(), m * n, b.get());
+    std::copy_n(a.get(), m * n, c.get());
+    std::copy_n(a.get(), m * n, d.get());
+    std::size_t k = std::min(m, n);
+    auto pivots_b = std::make_unique<std::size_t[]>(k);
+    auto pivots_c = std::make_unique<std::size_t[]>(k);
+    auto pivots_d = std::make_unique<std::size_t[]>(k);
+    REQUIRE(naive_lu_factor(b.get(), n, m, n, pivots_b.get()));
+    REQUIRE(lu_factor(c.get(), n, m, n, pivots_c.get()));
+    REQUIRE(lu_factor<TestType, 8>(d.get(), n, m, n, pivots_d.get()));
+
+    double eps = tolerance<TestType>();
+    for (auto [lu, pivots] : {std::pair(b.get(), pivots_b.get()),
+                              std::pair(c.get(), pivots_c.get()),
+                              std::pair(d.get(), pivots_d.get())}) {
+      auto r = reconstruct(lu, m, n, pivots);
+      for (std::size_t i = 0; i < m * n; ++i) {
+        REQUIRE(std::abs(r[i] - a[i]) <= eps);
+      }
+      // Partial pivoting bounds the multipliers by one
+      for (std::size_t i = 0; i < m; ++i) {
+        for (std::size_t j = 0; j < std::min(i, k); ++j) {
+          REQUIRE(std::abs(lu[i * n + j]) <= 1 + eps);
+        }
+      }
+    }
+  }
+
+  SECTION("Singular.") {
+    std::size_t n = 100;
+    auto a = std::make_unique<TestType[]>(n * n);
+    std::generate_n(a.get(), n * n, [&] { return random_element<TestType>(rng); });
+    // A zero row stays exactly zero through the elimination
+    std::fill_n(a.get() + 40 * n, n, TestType(0));
+    auto pivots = std::make_unique<std::size_t[]>(n);
+    REQUIRE(!lu_factor<TestType, 8>(a.get(), n, n, n, pivots.get()));
+  }
+
+  SECTION("Solve.") {
+    std::size_t n = 120;
+    std::size_t nrhs = 30;
+    auto a = std::make_unique<TestType[]>(n * n);
+    auto x = std::make_unique<TestType[]>(n * nrhs);
+    std::generate_n(a.get(), n * n, [&] { return random_element<TestType>(rng); });
+    std::generate_n(x.get(), n * nrhs, [&] { return random_element<TestType>(rng); });
+    auto b = std::make_unique<TestType[]>(n * nrhs);
+    naive_matrix_multiply(a.get(), x.get(), n, n, nrhs, b.get());
+
+    auto pivots = std::make_unique<std::size_t[]>(n);
+    REQUIRE(lu_factor<TestType, 8>(a.get(), n, n, n, pivots.get()));
+    lu_solve<TestType, 8>(a.get(), n, n, pivots.get(), b.get(), nrhs, nrhs);
+    // Random matrices are well enough conditioned for a looser bound
+    double eps = 100 * tolerance<TestType>();
+    for (std::size_t i = 0; i < n * nrhs; ++i) {
+      REQUIRE(std::abs(b[i] - x[i]) <= eps);
+    }
+  }
+}
@@ -1,9 +1,17 @@
 #define CATCH_CONFIG_MAIN
 
 #include <ra/matrix_multiply.hpp>
+#include <ra/morton_matrix.hpp>
 
+#include <algorithm>
 #include <catch2/catch.hpp>
+#include <cstdint>
+#include <limits>
 #include <memory>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 using namespace ra::cache;
 
@@ -40,3 +48,468 @@ TEST_CASE("Matrix multiply.") {
     check_matrix_equal(c.get(), f.get(), 100, 200);
   }
 }
+
+TEST_CASE("Matrix multiply, varying leaf sizes.") {
+  std::unique_ptr<double> a = random_matrix<double>(70, 90);
+  std::unique_ptr<double> b = random_matrix<double>(90, 50);
+  std::unique_ptr<double> c(new double[70 * 50]());
+  std::unique_ptr<double> d(new double[70 * 50]());
+  std::unique_ptr<double> e(new double[70 * 50]());
+
+  naive_matrix_multiply(a.get(), b.get(), 70, 90, 50, c.get());
+  matrix_multiply<double, 1>(a.get(), b.get(), 70, 90, 50, d.get());
+  matrix_multiply<double, 4096>(a.get(), b.get(), 70, 90, 50, e.get());
+
+  check_matrix_equal(c.get(), d.get(), 70, 50);
+  check_matrix_equal(c.get(), e.get(), 70, 50);
+}
+
+TEST_CASE("Batched matrix multiply.") {
+  std::size_t m = 9;
+  std::size_t n = 13;
+  std::size_t p = 17;
+  std::size_t batch = 40;
+  std::unique_ptr<double> a = random_matrix<double>(batch, m * n);
+  std::unique_ptr<double> b = random_matrix<double>(batch, n * p, 7);
+  std::unique_ptr<double> expected(new double[batch * m * p]());
+  std::unique_ptr<double> c(new double[batch * m * p]());
+
+  SECTION("Contiguous.") {
+    for (std::size_t k = 0; k < batch; ++k) {
+      naive_matrix_multiply(a.get() + k * m * n, b.get() + k * n * p, m, n, p,
+                            expected.get() + k * m * p);
+    }
+    batched_matrix_multiply(a.get(), b.get(), m, n, p, c.get(), batch);
+    check_matrix_equal(c.get(), expected.get(), batch, m * p);
+  }
+
+  SECTION("Shared b, parallel.") {
+    for (std::size_t k = 0; k < batch; ++k) {
+      naive_matrix_multiply(a.get() + k * m * n, b.get(), m, n, p,
+                            expected.get() + k * m * p);
+    }
+    thread_pool pool(4);
+    batched_matrix_multiply(a.get(), b.get(), m, n, p, c.get(), batch, m * n,
+                            0, m * p, pool);
+    check_matrix_equal(c.get(), expected.get(), batch, m * p);
+  }
+}
+
+TEST_CASE("Parallel matrix multiply.") {
+  thread_pool pool(4);
+  std::size_t dims[][3] = {{30, 400, 20}, {97, 33, 61}, {300, 600, 300}};
+  for (auto &dim : dims) {
+    std::size_t m = dim[0];
+    std::size_t n = dim[1];
+    std::size_t p = dim[2];
+    std::unique_ptr<double> a = random_matrix<double>(m, n);
+    std::unique_ptr<double> b = random_matrix<double>(n, p, 7);
+    std::unique_ptr<double> c = random_matrix<double>(m, p, 11);
+    std::unique_ptr<double> d = copy_matrix<double>(c.get(), m, p);
+
+    matrix_multiply(a.get(), b.get(), m, n, p, c.get());
+    // A small grain forces splits of all three kinds onto the pool
+    matrix_multiply(a.get(), b.get(), m, n, p, d.get(), pool, 512);
+    check_matrix_equal(c.get(), d.get(), m, p);
+  }
+
+  SECTION("Thread count.") {
+    std::unique_ptr<double> a = random_matrix<double>(64, 256);
+    std::unique_ptr<double> b = random_matrix<double>(256, 64, 7);
+    std::unique_ptr<double> c(new double[64 * 64]());
+    std::unique_ptr<double> d(new double[64 * 64]());
+    naive_matrix_multiply(a.get(), b.get(), 64, 256, 64, c.get());
+    matrix_multiply(a.get(), b.get(), 64, 256, 64, d.get(), 3);
+    check_matrix_equal(c.get(), d.get(), 64, 64);
+  }
+}
+
+TEMPLATE_TEST_CASE("Matrix multiply, register kernels.", "", std::int8_t,
+                   std::int16_t, std::int32_t, std::int64_t, float, double) {
+  // Small integer entries keep float sums exact and make integer overflow
+  // wrap the same way in every order of summation
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> dis(-8, 8);
+  std::size_t dims[][3] = {{6, 5, 32}, {61, 45, 77}, {130, 70, 150}};
+  for (auto &dim : dims) {
+    std::size_t m = dim[0];
+    std::size_t n = dim[1];
+    std::size_t p = dim[2];
+    auto a = std::make_unique<TestType[]>(m * n);
+    auto b = std::make_unique<TestType[]>(n * p);
+    auto c = std::make_unique<TestType[]>(m * p);
+    auto d = std::make_unique<TestType[]>(m * p);
+    for (std::size_t i = 0; i < m * n; ++i) {
+      a[i] = TestType(dis(rng));
+    }
+    for (std::size_t i = 0; i < n * p; ++i) {
+      b[i] = TestType(dis(rng));
+    }
+    for (std::size_t i = 0; i < m * p; ++i) {
+      c[i] = d[i] = TestType(dis(rng));
+    }
+
+    // Leaf 1 never reaches the kernel
+    matrix_multiply(a.get(), b.get(), m, n, p, c.get());
+    matrix_multiply<TestType, 1>(a.get(), b.get(), m, n, p, d.get());
+    for (std::size_t i = 0; i < m * p; ++i) {
+      REQUIRE(c[i] == d[i]);
+    }
+  }
+}
+
+TEMPLATE_TEST_CASE("Strassen matrix multiply, accuracy.", "", float, double) {
+  // Entries in [-1, 1] so that the error bound is relative to n * epsilon
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<TestType> dis(-1, 1);
+  std::size_t dims[][3] = {{256, 256, 256}, {301, 257, 283}, {64, 400, 90}};
+  for (auto &dim : dims) {
+    std::size_t m = dim[0];
+    std::size_t n = dim[1];
+    std::size_t p = dim[2];
+    auto a = std::make_unique<TestType[]>(m * n);
+    auto b = std::make_unique<TestType[]>(n * p);
+    auto c = std::make_unique<TestType[]>(m * p);
+    for (std::size_t i = 0; i < m * n; ++i) {
+      a[i] = dis(rng);
+    }
+    for (std::size_t i = 0; i < n * p; ++i) {
+      b[i] = dis(rng);
+    }
+    for (std::size_t i = 0; i < m * p; ++i) {
+      c[i] = dis(rng);
+    }
+
+    // Reference in long double on top of the same c
+    auto expected = std::make_unique<long double[]>(m * p);
+    for (std::size_t i = 0; i < m; ++i) {
+      for (std::size_t k = 0; k < p; ++k) {
+        long double sum = c[i * p + k];
+        for (std::size_t j = 0; j < n; ++j) {
+          sum += (long double)a[i * n + j] * b[j * p + k];
+        }
+        expected[i * p + k] = sum;
+      }
+    }
+
+    // A threshold of 16 recurses several levels, through odd dimensions too
+    strassen_multiply<TestType, 16>(a.get(), b.get(), m, n, p, c.get());
+    long double margin = 16 * n * std::numeric_limits<TestType>::epsilon();
+    for (std::size_t i = 0; i < m * p; ++i) {
+      REQUIRE(c[i] == Approx(expected[i]).margin(margin));
+    }
+  }
+}
+
+TEMPLATE_TEST_CASE("Strassen matrix multiply, integer types.", "",
+                   std::int8_t, std::int32_t, std::int64_t) {
+  // Integer arithmetic wraps the same way in every order, so Strassen must
+  // agree exactly with the classical multiply
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<int> dis(-100, 100);
+  std::size_t m = 131;
+  std::size_t n = 96;
+  std::size_t p = 75;
+  auto a = std::make_unique<TestType[]>(m * n);
+  auto b = std::make_unique<TestType[]>(n * p);
+  auto c = std::make_unique<TestType[]>(m * p);
+  auto d = std::make_unique<TestType[]>(m * p);
+  for (std::size_t i = 0; i < m * n; ++i) {
+    a[i] = TestType(dis(rng));
+  }
+  for (std::size_t i = 0; i < n * p; ++i) {
+    b[i] = TestType(dis(rng));
+  }
+  for (std::size_t i = 0; i < m * p; ++i) {
+    c[i] = d[i] = TestType(dis(rng));
+  }
+
+  matrix_multiply(a.get(), b.get(), m, n, p, c.get());
+  strassen_multiply<TestType, 8>(a.get(), b.get(), m, n, p, d.get());
+  for (std::size_t i = 0; i < m * p; ++i) {
+    REQUIRE(c[i] == d[i]);
+  }
+}
+
+TEMPLATE_TEST_CASE("Morton matrix multiply.", "", std::int32_t, float,
+                   double) {
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> dis(-8, 8);
+  std::size_t dims[][3] = {{48, 48, 48}, {100, 37, 130}, {5, 300, 200}};
+  for (auto &dim : dims) {
+    std::size_t m = dim[0];
+    std::size_t n = dim[1];
+    std::size_t p = dim[2];
+    auto a = std::make_unique<TestType[]>(m * n);
+    auto b = std::make_unique<TestType[]>(n * p);
+    auto c = std::make_unique<TestType[]>(m * p);
+    for (std::size_t i = 0; i < m * n; ++i) {
+      a[i] = TestType(dis(rng));
+    }
+    for (std::size_t i = 0; i < n * p; ++i) {
+      b[i] = TestType(dis(rng));
+    }
+    for (std::size_t i = 0; i < m * p; ++i) {
+      c[i] = TestType(dis(rng));
+    }
+
+    morton_matrix<TestType> ma(a.get(), m, n);
+    morton_matrix<TestType> mb(b.get(), n, p);
+    morton_matrix<TestType> mc(c.get(), m, p);
+    matrix_multiply(ma, mb, mc);
+    // Twice, so that padding left non-zero by the first would show up
+    matrix_multiply(ma, mb, mc);
+    auto d = std::make_unique<TestType[]>(m * p);
+    mc.to_row_major(d.get());
+
+    matrix_multiply<TestType, 1>(a.get(), b.get(), m, n, p, c.get());
+    matrix_multiply<TestType, 1>(a.get(), b.get(), m, n, p, c.get());
+    for (std::size_t i = 0; i < m * p; ++i) {
+      REQUIRE(d[i] == c[i]);
+    }
+  }
+
+  SECTION("Mismatched dimensions.") {
+    morton_matrix<TestType> a(10, 20);
+    morton_matrix<TestType> b(30, 10);
+    morton_matrix<TestType> c(10, 10);
+    REQUIRE_THROWS_AS(matrix_multiply(a, b, c), std::invalid_argument);
+  }
+}
+
+TEMPLATE_TEST_CASE("General matrix multiply.", "", std::int32_t, double) {
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> dis(-8, 8);
+  std::size_t m = 70;
+  std::size_t n = 45;
+  std::size_t p = 90;
+  // Row lengths wider than the matrices, as for blocks of larger ones
+  std::size_t ld = 101;
+  auto a = std::make_unique<TestType[]>(ld * ld);
+  auto b = std::make_unique<TestType[]>(ld * ld);
+  auto c = std::make_unique<TestType[]>(ld * ld);
+  for (std::size_t i = 0; i < ld * ld; ++i) {
+    a[i] = TestType(dis(rng));
+    b[i] = TestType(dis(rng));
+    c[i] = TestType(dis(rng));
+  }
+
+  matrix_op ops[] = {matrix_op::none, matrix_op::transpose};
+  TestType scalars[][2] = {{1, 1}, {1, 0}, {3, -2}, {0, 5}};
+  for (matrix_op op_a : ops) {
+    for (matrix_op op_b : ops) {
+      for (auto &scalar : scalars) {
+        auto d = std::make_unique<TestType[]>(ld * ld);
+        auto e = std::make_unique<TestType[]>(ld * ld);
+        std::copy_n(c.get(), ld * ld, d.get());
+        std::copy_n(c.get(), ld * ld, e.get());
+        naive_gemm(op_a, op_b, m, n, p, scalar[0], a.get(), ld, b.get(), ld,
+                   scalar[1], d.get(), ld);
+        gemm(op_a, op_b, m, n, p, scalar[0], a.get(), ld, b.get(), ld,
+             scalar[1], e.get(), ld);
+        // Small leaves split every dimension, including through the packing
+        auto f = std::make_unique<TestType[]>(ld * ld);
+        std::copy_n(c.get(), ld * ld, f.get());
+        gemm<TestType, 64>(op_a, op_b, m, n, p, scalar[0], a.get(), ld,
+                           b.get(), ld, scalar[1], f.get(), ld);
+        for (std::size_t i = 0; i < ld * ld; ++i) {
+          REQUIRE(e[i] == d[i]);
+          REQUIRE(f[i] == d[i]);
+        }
+      }
+    }
+  }
+
+  SECTION("Matches matrix_multiply and naive_matrix_multiply.") {
+    auto d = std::make_unique<TestType[]>(m * p);
+    auto e = std::make_unique<TestType[]>(m * p);
+    naive_matrix_multiply(a.get(), b.get(), m, n, p, d.get());
+    std::copy_n(c.get(), m * p, e.get());
+    gemm(matrix_op::none, matrix_op::none, m, n, p, TestType(1), a.get(), n,
+         b.get(), p, TestType(0), e.get(), p);
+    for (std::size_t i = 0; i < m * p; ++i) {
+      REQUIRE(e[i] == d[i]);
+    }
+
+    std::copy_n(c.get(), m * p, d.get());
+    matrix_multiply(a.get(), b.get(), m, n, p, d.get());
+    gemm(matrix_op::none, matrix_op::none, m, n, p, TestType(1), a.get(), n,
+         b.get(), p, TestType(1), c.get(), p);
+    for (std::size_t i = 0; i < m * p; ++i) {
+      REQUIRE(c[i] == d[i]);
+    }
+  }
+}
+
+TEMPLATE_TEST_CASE("Widening matrix multiply.", "",
+                   (std::pair<std::int8_t, std::int16_t>),
+                   (std::pair<std::int8_t, std::int32_t>),
+                   (std::pair<std::int16_t, std::int32_t>),
+                   (std::pair<std::int16_t, std::int64_t>),
+                   (std::pair<std::int8_t, std::int64_t>),
+                   (std::pair<float, double>)) {
+  using T = typename TestType::first_type;
+  using U = typename TestType::second_type;
+  // The reference is summed wide enough that it cannot overflow
+  using R = std::conditional_t<std::is_integral_v<U>, std::int64_t, U>;
+  // Odd inner dimensions leave a single step after the pairs
+  std::size_t dims[][3] = {{6, 2, 16}, {61, 45, 77}, {130, 71, 150}};
+  // The full input range, which overflows T almost immediately, narrowed
+  // only where U could not hold (n + 1) max|a| max|b| exactly
+  int lo = -100;
+  int hi = 100;
+  if constexpr (std::is_integral_v<T>) {
+    lo = std::numeric_limits<T>::min();
+    hi = std::numeric_limits<T>::max();
+    R bound = R(std::numeric_limits<U>::max()) / R(dims[2][1] + 1);
+    while (R(lo) * R(lo) > bound) {
+      ++lo;
+      hi = -lo;
+    }
+  }
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> dis(lo, hi);
+  for (auto &dim : dims) {
+    std::size_t m = dim[0];
+    std::size_t n = dim[1];
+    std::size_t p = dim[2];
+    auto a = std::make_unique<T[]>(m * n);
+    auto b = std::make_unique<T[]>(n * p);
+    auto c = std::make_unique<U[]>(m * p);
+    auto d = std::make_unique<U[]>(m * p);
+    auto expected = std::make_unique<R[]>(m * p);
+    for (std::size_t i = 0; i < m * n; ++i) {
+      a[i] = T(dis(rng));
+    }
+    for (std::size_t i = 0; i < n * p; ++i) {
+      b[i] = T(dis(rng));
+    }
+    for (std::size_t i = 0; i < m * p; ++i) {
+      c[i] = d[i] = U(dis(rng));
+      expected[i] = R(c[i]);
+    }
+    for (std::size_t i = 0; i < m; ++i) {
+      for (std::size_t k = 0; k < p; ++k) {
+        for (std::size_t j = 0; j < n; ++j) {
+          expected[i * p + k] += R(a[i * n + j]) * R(b[j * p + k]);
+        }
+        REQUIRE(expected[i * p + k] >= R(std::numeric_limits<U>::lowest()));
+        REQUIRE(expected[i * p + k] <= R(std::numeric_limits<U>::max()));
+      }
+    }
+
+    matrix_multiply(a.get(), b.get(), m, n, p, c.get());
+    packed_matrix_multiply(a.get(), b.get(), m, n, p, d.get());
+    for (std::size_t i = 0; i < m * p; ++i) {
+      REQUIRE(c[i] == U(expected[i]));
+      REQUIRE(d[i] == U(expected[i]));
+    }
+  }
+}
+
+TEMPLATE_TEST_CASE("Packed matrix multiply.", "", std::int8_t, std::int16_t,
+                   std::int32_t, std::int64_t, float, double, long double) {
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> dis(-8, 8);
+  std::size_t dims[][3] = {{1, 1, 1}, {6, 5, 32}, {61, 45, 77}, {130, 70, 150}};
+  // Blocks small enough that every loop runs several times with a ragged end
+  packed_blocking small = {12, 16, 64};
+  for (auto &dim : dims) {
+    std::size_t m = dim[0];
+    std::size_t n = dim[1];
+    std::size_t p = dim[2];
+    auto a = std::make_unique<TestType[]>(m * n);
+    auto b = std::make_unique<TestType[]>(n * p);
+    auto c = std::make_unique<TestType[]>(m * p);
+    auto d = std::make_unique<TestType[]>(m * p);
+    auto e = std::make_unique<TestType[]>(m * p);
+    for (std::size_t i = 0; i < m * n; ++i) {
+      a[i] = TestType(dis(rng));
+    }
+    for (std::size_t i = 0; i < n * p; ++i) {
+      b[i] = TestType(dis(rng));
+    }
+    for (std::size_t i = 0; i < m * p; ++i) {
+      c[i] = d[i] = e[i] = TestType(dis(rng));
+    }
+
+    matrix_multiply<TestType, 1>(a.get(), b.get(), m, n, p, c.get());
+    packed_matrix_multiply(a.get(), b.get(), m, n, p, d.get());
+    packed_matrix_multiply(a.get(), b.get(), m, n, p, e.get(), small);
+    for (std::size_t i = 0; i < m * p; ++i) {
+      REQUIRE(d[i] == c[i]);
+      REQUIRE(e[i] == c[i]);
+    }
+  }
+
+  SECTION("Block sizes that are not multiples of the register block.") {
+    std::size_t m = 100;
+    std::size_t n = 50;
+    std::size_t p = 40;
+    auto a = std::make_unique<TestType[]>(m * n);
+    auto b = std::make_unique<TestType[]>(n * p);
+    auto c = std::make_unique<TestType[]>(m * p);
+    auto d = std::make_unique<TestType[]>(m * p);
+    for (std::size_t i = 0; i < m * n; ++i) {
+      a[i] = TestType(dis(rng));
+    }
+    for (std::size_t i = 0; i < n * p; ++i) {
+      b[i] = TestType(dis(rng));
+    }
+    matrix_multiply<TestType, 1>(a.get(), b.get(), m, n, p, c.get());
+    packed_matrix_multiply(a.get(), b.get(), m, n, p, d.get(),
+                           packed_blocking{10, 16, 7});
+    for (std::size_t i = 0; i < m * p; ++i) {
+      REQUIRE(d[i] == c[i]);
+    }
+    packed_blocking empty = {0, 16, 8};
+    REQUIRE_THROWS_AS(
+        packed_matrix_multiply(a.get(), b.get(), m, n, p, d.get(), empty),
+        std::invalid_argument);
+  }
+
+  SECTION("Widening.") {
+    std::size_t m = 61;
+    std::size_t n = 45;
+    std::size_t p = 77;
+    auto a = std::make_unique<TestType[]>(m * n);
+    auto b = std::make_unique<TestType[]>(n * p);
+    auto c = std::make_unique<long double[]>(m * p);
+    auto d = std::make_unique<long double[]>(m * p);
+    for (std::size_t i = 0; i < m * n; ++i) {
+      a[i] = TestType(dis(rng));
+    }
+    for (std::size_t i = 0; i < n * p; ++i) {
+      b[i] = TestType(dis(rng));
+    }
+    matrix_multiply<TestType, 1>(a.get(), b.get(), m, n, p, c.get());
+    packed_matrix_multiply(a.get(), b.get(), m, n, p, d.get(), small);
+    for (std::size_t i = 0; i < m * p; ++i) {
+      REQUIRE(d[i] == c[i]);
+    }
+  }
+}
+
+TEST_CASE("Packed matrix multiply, widening kernels.") {
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> dis(-128, 127);
+  std::size_t m = 61;
+  std::size_t n = 45;
+  std::size_t p = 77;
+  auto a = std::make_unique<std::int8_t[]>(m * n);
+  auto b = std::make_unique<std::int8_t[]>(n * p);
+  auto c = std::make_unique<std::int32_t[]>(m * p);
+  auto d = std::make_unique<std::int32_t[]>(m * p);
+  for (std::size_t i = 0; i < m * n; ++i) {
+    a[i] = std::int8_t(dis(rng));
+  }
+  for (std::size_t i = 0; i < n * p; ++i) {
+    b[i] = std::int8_t(dis(rng));
+  }
+  matrix_multiply<std::int8_t, 1>(a.get(), b.get(), m, n, p, c.get());
+  packed_matrix_multiply(a.get(), b.get(), m, n, p, d.get(),
+                         packed_blocking{12, 15, 64});
+  for (std::size_t i = 0; i < m * p; ++i) {
+    REQUIRE(d[i] == c[i]);
+  }
+}
@@ -1,8 +1,17 @@
 #define CATCH_CONFIG_MAIN
 
+#include "ra/mapped_transpose.hpp"
 #include "ra/matrix_transpose.hpp"
+#include "ra/morton_matrix.hpp"
+
+#include <unistd.h>
 
 #include <catch2/catch.hpp>
+#include <complex>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
 
 using namespace ra::cache;
 
@@ -73,6 +82,27 @@ TEST_CASE("Cache oblivious matrix transpose.") {
       }
     }
   }
+  SECTION("In-place rectangular transpose.") {
+    std::size_t dims[][2] = {{1, 7}, {7, 1}, {2, 3}, {30, 10}, {10, 30},
+                             {64, 16}, {16, 64}, {33, 17}, {17, 33}};
+    for (auto &dim : dims) {
+      std::size_t m = dim[0];
+      std::size_t n = dim[1];
+      int *a = new int[m * n];
+      int *b = new int[m * n];
+      for (std::size_t i = 0; i < m * n; ++i) {
+        a[i] = i;
+        b[i] = i;
+      }
+      naive_matrix_transpose(a, m, n, a);
+      matrix_transpose(b, m, n, b);
+      for (std::size_t i = 0; i < m * n; ++i) {
+        REQUIRE(b[i] == a[i]);
+      }
+      delete [] a;
+      delete [] b;
+    }
+  }
   SECTION("Dynamic storage duration.") {
     int *a = new int[10000];
     int *b = new int[10000];
@@ -93,3 +123,290 @@ TEST_CASE("Cache oblivious matrix transpose.") {
     delete [] b;
   }
 }
+
+TEMPLATE_TEST_CASE("Cache oblivious matrix transpose, varying types.", "",
+                   std::int8_t, std::int16_t, std::int32_t, std::int64_t,
+                   std::complex<std::int8_t>, std::complex<std::int32_t>,
+                   std::complex<std::int64_t>, std::complex<double>) {
+  std::size_t dims[][2] = {{8, 8}, {16, 16}, {64, 32}, {32, 64}, {37, 53},
+                           {100, 7}, {7, 100}};
+  for (auto &dim : dims) {
+    std::size_t m = dim[0];
+    std::size_t n = dim[1];
+    auto a = std::make_unique<TestType[]>(m * n);
+    auto b = std::make_unique<TestType[]>(m * n);
+    auto c = std::make_unique<TestType[]>(m * n);
+    for (std::size_t i = 0; i < m * n; ++i) {
+      a[i] = TestType(i % 127);
+    }
+    naive_matrix_transpose(a.get(), m, n, b.get());
+    matrix_transpose(a.get(), m, n, c.get());
+    for (std::size_t i = 0; i < m * n; ++i) {
+      REQUIRE(b[i] == c[i]);
+    }
+    matrix_transpose<TestType, 1>(a.get(), m, n, c.get());
+    for (std::size_t i = 0; i < m * n; ++i) {
+      REQUIRE(b[i] == c[i]);
+    }
+    matrix_transpose<TestType, 1024>(a.get(), m, n, c.get());
+    for (std::size_t i = 0; i < m * n; ++i) {
+      REQUIRE(b[i] == c[i]);
+    }
+    matrix_transpose<TestType, 16>(c.get(), n, m, c.get());
+    for (std::size_t i = 0; i < m * n; ++i) {
+      REQUIRE(a[i] == c[i]);
+    }
+  }
+}
+
+TEST_CASE("Parallel matrix transpose.") {
+  thread_pool pool(4);
+  std::size_t dims[][2] = {{1, 300}, {256, 256}, {300, 200}, {200, 300},
+                           {333, 111}, {111, 333}, {257, 263}};
+  for (auto &dim : dims) {
+    std::size_t m = dim[0];
+    std::size_t n = dim[1];
+    auto a = std::make_unique<int[]>(m * n);
+    auto b = std::make_unique<int[]>(m * n);
+    auto c = std::make_unique<int[]>(m * n);
+    auto d = std::make_unique<int[]>(m * n);
+    for (std::size_t i = 0; i < m * n; ++i) {
+      a[i] = i;
+      c[i] = i;
+    }
+    naive_matrix_transpose(a.get(), m, n, b.get());
+    matrix_transpose(a.get(), m, n, d.get(), pool, 64);
+    matrix_transpose(c.get(), m, n, c.get(), pool, 64);
+    for (std::size_t i = 0; i < m * n; ++i) {
+      REQUIRE(d[i] == b[i]);
+      REQUIRE(c[i] == b[i]);
+    }
+  }
+
+  SECTION("Thread count.") {
+    auto a = std::make_unique<int[]>(500 * 700);
+    auto b = std::make_unique<int[]>(500 * 700);
+    auto c = std::make_unique<int[]>(500 * 700);
+    for (std::size_t i = 0; i < 500 * 700; ++i) {
+      a[i] = i;
+    }
+    naive_matrix_transpose(a.get(), 500, 700, b.get());
+    matrix_transpose(a.get(), 500, 700, c.get(), 3);
+    for (std::size_t i = 0; i < 500 * 700; ++i) {
+      REQUIRE(c[i] == b[i]);
+    }
+  }
+}
+
+TEST_CASE("Transform transpose.") {
+  // Square, stacked and adjacent square blocks, and shapes without them
+  std::size_t dims[][2] = {{1, 1},    {1, 300},   {300, 1},  {256, 256},
+                           {300, 100}, {100, 300}, {257, 263}, {64, 48}};
+  // Depends on both the element and where it was found
+  auto op = [](long long x, std::size_t i, std::size_t j) {
+    return 3 * x + (long long)i - 2 * (long long)j;
+  };
+  for (auto &dim : dims) {
+    std::size_t m = dim[0];
+    std::size_t n = dim[1];
+    auto a = std::make_unique<long long[]>(m * n);
+    auto b = std::make_unique<long long[]>(m * n);
+    auto c = std::make_unique<long long[]>(m * n);
+    auto d = std::make_unique<long long[]>(m * n);
+    for (std::size_t i = 0; i < m * n; ++i) {
+      a[i] = i;
+      c[i] = i;
+      d[i] = i;
+    }
+    transform_transpose(a.get(), m, n, b.get(), op);
+    transform_transpose(c.get(), m, n, c.get(), op);
+    transform_transpose<long long, 4>(d.get(), m, n, d.get(), op);
+    for (std::size_t i = 0; i < m; ++i) {
+      for (std::size_t j = 0; j < n; ++j) {
+        long long expected = op(a[i * n + j], i, j);
+        REQUIRE(b[j * m + i] == expected);
+        REQUIRE(c[j * m + i] == expected);
+        REQUIRE(d[j * m + i] == expected);
+      }
+    }
+  }
+
+  SECTION("Empty and vector shapes.") {
+    std::size_t shapes[][2] = {{0, 5}, {5, 0}, {0, 0}, {1, 7}, {7, 1}};
+    for (auto &shape : shapes) {
+      std::size_t m = shape[0];
+      std::size_t n = shape[1];
+      // One element of room keeps the pointers valid for empty shapes
+      auto a = std::make_unique<long long[]>(m * n + 1);
+      auto b = std::make_unique<long long[]>(m * n + 1);
+      auto c = std::make_unique<long long[]>(m * n + 1);
+      auto d = std::make_unique<long long[]>(m * n + 1);
+      for (std::size_t i = 0; i < m * n; ++i) {
+        a[i] = c[i] = d[i] = i;
+      }
+      transform_transpose(a.get(), m, n, b.get(), op);
+      transform_transpose(c.get(), m, n, c.get(), op);
+      transform_transpose<long long, 4>(d.get(), m, n, d.get(), op);
+      for (std::size_t i = 0; i < m; ++i) {
+        for (std::size_t j = 0; j < n; ++j) {
+          long long expected = op(a[i * n + j], i, j);
+          REQUIRE(b[j * m + i] == expected);
+          REQUIRE(c[j * m + i] == expected);
+          REQUIRE(d[j * m + i] == expected);
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Memory-mapped matrix transpose.") {
+  // Named by process, so that concurrent test runs do not share files
+  auto dir = std::filesystem::temp_directory_path();
+  std::string id = std::to_string(::getpid());
+  std::string in = (dir / ("ra_test_transpose_in_" + id + ".bin")).string();
+  std::string out = (dir / ("ra_test_transpose_out_" + id + ".bin")).string();
+  std::string naive_out =
+      (dir / ("ra_test_transpose_naive_" + id + ".bin")).string();
+
+  std::size_t m = 300;
+  std::size_t n = 170;
+  {
+    std::ofstream file(in, std::ios::binary);
+    for (std::int64_t i = 0; i < static_cast<std::int64_t>(m * n); ++i) {
+      file.write(reinterpret_cast<const char *>(&i), sizeof(i));
+    }
+  }
+
+  matrix_transpose_file<std::int64_t>(in, m, n, out, map_advice::random);
+  naive_matrix_transpose_file<std::int64_t>(in, m, n, naive_out);
+  {
+    mapped_file a(out);
+    mapped_file b(naive_out);
+    REQUIRE(a.size() == m * n * sizeof(std::int64_t));
+    REQUIRE(b.size() == m * n * sizeof(std::int64_t));
+    auto c = static_cast<const std::int64_t *>(a.data());
+    auto d = static_cast<const std::int64_t *>(b.data());
+    for (std::size_t i = 0; i < m; ++i) {
+      for (std::size_t j = 0; j < n; ++j) {
+        REQUIRE(c[j * m + i] == static_cast<std::int64_t>(i * n + j));
+        REQUIRE(d[j * m + i] == static_cast<std::int64_t>(i * n + j));
+      }
+    }
+  }
+
+  REQUIRE_THROWS_AS(matrix_transpose_file<std::int64_t>(in, m + 1, n, out),
+                    std::invalid_argument);
+  REQUIRE_THROWS_AS(
+      matrix_transpose_file<std::int64_t>((dir / "ra_missing").string(), m, n,
+                                          out),
+      std::system_error);
+
+  // Other spellings of the input path must not truncate it
+  std::string alias = (dir / "." / ("ra_test_transpose_in_" + id + ".bin"))
+                          .string();
+  std::string link =
+      (dir / ("ra_test_transpose_link_" + id + ".bin")).string();
+  std::filesystem::create_symlink(in, link);
+  REQUIRE_THROWS_AS(matrix_transpose_file<std::int64_t>(in, m, n, alias),
+                    std::invalid_argument);
+  REQUIRE_THROWS_AS(matrix_transpose_file<std::int64_t>(in, m, n, link),
+                    std::invalid_argument);
+  REQUIRE(std::filesystem::file_size(in) == m * n * sizeof(std::int64_t));
+
+  std::filesystem::remove(in);
+  std::filesystem::remove(out);
+  std::filesystem::remove(naive_out);
+  std::filesystem::remove(link);
+}
+
+TEST_CASE("Batched matrix transpose.") {
+  std::size_t m = 12;
+  std::size_t n = 20;
+  std::size_t batch = 50;
+  // Leave a gap between matrices to exercise the strides
+  std::size_t stride = m * n + 3;
+  auto a = std::make_unique<int[]>(batch * stride);
+  auto expected = std::make_unique<int[]>(batch * stride);
+  for (std::size_t i = 0; i < batch * stride; ++i) {
+    a[i] = i;
+  }
+  for (std::size_t k = 0; k < batch; ++k) {
+    naive_matrix_transpose(a.get() + k * stride, m, n,
+                           expected.get() + k * stride);
+  }
+
+  SECTION("Contiguous.") {
+    auto b = std::make_unique<int[]>(batch * m * n);
+    batched_matrix_transpose(a.get(), m, n, b.get(), batch, stride, m * n);
+    for (std::size_t k = 0; k < batch; ++k) {
+      for (std::size_t i = 0; i < m * n; ++i) {
+        REQUIRE(b[k * m * n + i] == expected[k * stride + i]);
+      }
+    }
+  }
+
+  SECTION("Parallel.") {
+    thread_pool pool(4);
+    auto b = std::make_unique<int[]>(batch * stride);
+    batched_matrix_transpose(a.get(), m, n, b.get(), batch, stride, stride,
+                             pool);
+    for (std::size_t k = 0; k < batch; ++k) {
+      for (std::size_t i = 0; i < m * n; ++i) {
+        REQUIRE(b[k * stride + i] == expected[k * stride + i]);
+      }
+    }
+  }
+
+  SECTION("Large matrices, in place.") {
+    auto b = std::make_unique<int[]>(3 * 100 * 70);
+    auto c = std::make_unique<int[]>(3 * 100 * 70);
+    for (std::size_t i = 0; i < 3 * 100 * 70; ++i) {
+      b[i] = i;
+    }
+    for (std::size_t k = 0; k < 3; ++k) {
+      naive_matrix_transpose(b.get() + k * 7000, 100, 70, c.get() + k * 7000);
+    }
+    batched_matrix_transpose(b.get(), 100, 70, b.get(), 3);
+    for (std::size_t i = 0; i < 3 * 100 * 70; ++i) {
+      REQUIRE(b[i] == c[i]);
+    }
+  }
+}
+
+TEST_CASE("Morton matrix.") {
+  // Shapes with odd tile grids, partial tiles and a single tile row
+  std::size_t dims[][2] = {{1, 1}, {37, 50}, {200, 130}, {7, 300}, {96, 96}};
+  for (auto &dim : dims) {
+    std::size_t m = dim[0];
+    std::size_t n = dim[1];
+    auto a = std::make_unique<int[]>(m * n);
+    for (std::size_t i = 0; i < m * n; ++i) {
+      a[i] = i;
+    }
+
+    morton_matrix<int> b(a.get(), m, n);
+    auto c = std::make_unique<int[]>(m * n);
+    b.to_row_major(c.get());
+    for (std::size_t i = 0; i < m; ++i) {
+      for (std::size_t j = 0; j < n; ++j) {
+        REQUIRE(b(i, j) == a[i * n + j]);
+        REQUIRE(c[i * n + j] == a[i * n + j]);
+      }
+    }
+
+    morton_matrix<int> d(n, m);
+    matrix_transpose(b, d);
+    auto e = std::make_unique<int[]>(m * n);
+    d.to_row_major(e.get());
+    naive_matrix_transpose(a.get(), m, n, c.get());
+    for (std::size_t i = 0; i < m * n; ++i) {
+      REQUIRE(e[i] == c[i]);
+    }
+  }
+
+  SECTION("Mismatched dimensions.") {
+    morton_matrix<int> a(10, 20);
+    morton_matrix<int> b(10, 20);
+    REQUIRE_THROWS_AS(matrix_transpose(a, b), std::invalid_argument);
+  }
+}
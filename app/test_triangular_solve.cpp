@@ -0,0 +1,109 @@
+#define CATCH_CONFIG_MAIN
+
+#include <ra/triangular_solve.hpp>
+
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <limits>
+#include <memory>
+#include <random>
+
+using namespace ra::cache;
+
+template <class T> T tolerance() { return sizeof(T) == 4 ? 1e-3 : 1e-9; }
+
+TEST_CASE("Naive triangular solve.") {
+  // x = {1, 2, 3} under a lower triangle with a non-unit diagonal
+  double a[] = {2, 0, 0, 1, 1, 0, 3, -1, 4};
+  double b[] = {2, 3, 13};
+  naive_triangular_solve(matrix_side::left, matrix_triangle::lower,
+                         matrix_op::none, matrix_diagonal::non_unit, 3, 1, a,
+                         3, b, 1);
+  REQUIRE(b[0] == Approx(1));
+  REQUIRE(b[1] == Approx(2));
+  REQUIRE(b[2] == Approx(3));
+}
+
+TEMPLATE_TEST_CASE("Triangular solve.", "", float, double) {
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<TestType> dis(-1, 1);
+  std::size_t m = 70;
+  std::size_t n = 45;
+  // Row lengths wider than the matrices, as for blocks of larger ones
+  std::size_t ld = 101;
+  auto b = std::make_unique<TestType[]>(ld * ld);
+  std::generate_n(b.get(), ld * ld, [&] { return dis(rng); });
+
+  matrix_side sides[] = {matrix_side::left, matrix_side::right};
+  matrix_triangle triangles[] = {matrix_triangle::lower,
+                                 matrix_triangle::upper};
+  matrix_op ops[] = {matrix_op::none, matrix_op::transpose};
+  matrix_diagonal diags[] = {matrix_diagonal::non_unit, matrix_diagonal::unit};
+  for (matrix_side side : sides) {
+    for (matrix_triangle triangle : triangles) {
+      for (matrix_op op : ops) {
+        for (matrix_diagonal diag : diags) {
+          std::size_t size = side == matrix_side::left ? m : n;
+          // The unused triangle, and a unit diagonal, hold NaN so that
+          // reading them shows up in the result. t is a clean dense copy.
+          auto a = std::make_unique<TestType[]>(ld * ld);
+          auto t = std::make_unique<TestType[]>(size * size);
+          for (std::size_t i = 0; i < size; ++i) {
+            for (std::size_t j = 0; j < size; ++j) {
+              bool inside = triangle == matrix_triangle::lower ? j < i : j > i;
+              // Small off-diagonal elements keep a unit triangle well
+              // conditioned
+              TestType x = dis(rng) / TestType(size);
+              if (i == j) {
+                x = diag == matrix_diagonal::unit ? 1 : 2 + x;
+              }
+              bool used = inside || (i == j && diag == matrix_diagonal::non_unit);
+              a[i * ld + j] =
+                  used ? x : std::numeric_limits<TestType>::quiet_NaN();
+              t[i * size + j] = inside || i == j ? x : TestType(0);
+            }
+          }
+
+          auto x = std::make_unique<TestType[]>(ld * ld);
+          auto y = std::make_unique<TestType[]>(ld * ld);
+          auto z = std::make_unique<TestType[]>(ld * ld);
+          std::copy_n(b.get(), ld * ld, x.get());
+          std::copy_n(b.get(), ld * ld, y.get());
+          std::copy_n(b.get(), ld * ld, z.get());
+          naive_triangular_solve(side, triangle, op, diag, m, n, a.get(), ld,
+                                 x.get(), ld);
+          triangular_solve(side, triangle, op, diag, m, n, a.get(), ld,
+                           y.get(), ld);
+          triangular_solve<TestType, 8>(side, triangle, op, diag, m, n,
+                                        a.get(), ld, z.get(), ld);
+
+          // Multiplying back by the triangle gives b
+          auto r = std::make_unique<TestType[]>(m * n);
+          if (side == matrix_side::left) {
+            naive_gemm(op, matrix_op::none, m, m, n, TestType(1), t.get(),
+                       size, y.get(), ld, TestType(0), r.get(), n);
+          } else {
+            naive_gemm(matrix_op::none, op, m, n, n, TestType(1), y.get(), ld,
+                       t.get(), size, TestType(0), r.get(), n);
+          }
+          TestType eps = tolerance<TestType>();
+          for (std::size_t i = 0; i < m; ++i) {
+            for (std::size_t j = 0; j < n; ++j) {
+              TestType expected = x[i * ld + j];
+              REQUIRE(y[i * ld + j] == Approx(expected).epsilon(eps).margin(eps));
+              REQUIRE(z[i * ld + j] == Approx(expected).epsilon(eps).margin(eps));
+              REQUIRE(r[i * n + j] ==
+                      Approx(b[i * ld + j]).epsilon(eps).margin(eps));
+            }
+          }
+          // Elements of b outside the m x n block are left alone
+          for (std::size_t i = 0; i < ld; ++i) {
+            for (std::size_t j = i < m ? n : 0; j < ld; ++j) {
+              REQUIRE(y[i * ld + j] == b[i * ld + j]);
+            }
+          }
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+
+#include "matrix_multiply.hpp"
+#include "triangular_solve.hpp"
+#include "tuning.hpp"
+
+namespace ra::cache {
+
+namespace {
+// Left-looking Cholesky of the n x n matrix at a: each element of L is its
+// entry of a minus the dot product of two row prefixes of L, which are
+// contiguous in row-major order.
+template <class T>
+bool cholesky_rows(T *a, std::size_t lda, std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    T *row = a + i * lda;
+    for (std::size_t j = 0; j <= i; ++j) {
+      const T *pivot_row = a + j * lda;
+      T sum = row[j];
+      for (std::size_t k = 0; k < j; ++k) {
+        sum -= row[k] * pivot_row[k];
+      }
+      if (j < i) {
+        row[j] = sum / pivot_row[j];
+      } else if (sum > T(0)) {
+        row[j] = std::sqrt(sum);
+      } else {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Lower triangle of c -= a a^T for the n x k matrix a. Off-diagonal blocks
+// go to the multiply, diagonal ones are split further so that the strictly
+// upper triangle of c is never touched.
+template <std::size_t Leaf, class T>
+void lower_rank_update(const T *a, std::size_t lda, std::size_t n,
+                       std::size_t k, T *c, std::size_t ldc) {
+  if (n <= Leaf) {
+    for (std::size_t i = 0; i < n; ++i) {
+      for (std::size_t j = 0; j <= i; ++j) {
+        T sum(0);
+        for (std::size_t l = 0; l < k; ++l) {
+          sum += a[i * lda + l] * a[j * lda + l];
+        }
+        c[i * ldc + j] -= sum;
+      }
+    }
+    return;
+  }
+
+  std::size_t n1 = n / 2;
+  const T *a2 = a + n1 * lda;
+  lower_rank_update<Leaf>(a, lda, n1, k, c, ldc);
+  gemm(matrix_op::none, matrix_op::transpose, n - n1, k, n1, T(-1), a2, lda,
+       a, lda, T(1), c + n1 * ldc, ldc);
+  lower_rank_update<Leaf>(a2, lda, n - n1, k, c + n1 * ldc + n1, ldc);
+}
+
+// Factors the leading half, solves for the block of L below it, removes
+// its contribution from the trailing half and factors that.
+template <std::size_t Leaf, class T>
+bool cholesky_helper(T *a, std::size_t lda, std::size_t n) {
+  if (n <= Leaf) {
+    return cholesky_rows(a, lda, n);
+  }
+
+  std::size_t n1 = n / 2;
+  std::size_t n2 = n - n1;
+  T *a21 = a + n1 * lda;
+  T *a22 = a21 + n1;
+  if (!cholesky_helper<Leaf>(a, lda, n1)) {
+    return false;
+  }
+  triangular_solve<T, Leaf>(matrix_side::right, matrix_triangle::lower,
+                            matrix_op::transpose, matrix_diagonal::non_unit,
+                            n2, n1, a, lda, a21, lda);
+  lower_rank_update<Leaf>(a21, lda, n2, n1, a22, lda);
+  return cholesky_helper<Leaf>(a22, lda, n2);
+}
+} // namespace
+
+// Factors the symmetric positive definite n x n matrix a with row length lda
+// as L L^T. Only the lower triangle of a is read, and it is overwritten with
+// L. Returns false if a is not positive definite, leaving a partly factored.
+template <class T, std::size_t Leaf = tuning<T>::solve_leaf>
+bool cholesky_factor(T *a, std::size_t lda, std::size_t n) {
+  static_assert(std::is_floating_point_v<T>,
+                "Cholesky factorization needs a real floating point type");
+  return cholesky_helper<Leaf>(a, lda, n);
+}
+
+template <class T>
+bool naive_cholesky_factor(T *a, std::size_t lda, std::size_t n) {
+  static_assert(std::is_floating_point_v<T>,
+                "Cholesky factorization needs a real floating point type");
+  return cholesky_rows(a, lda, n);
+}
+} // namespace ra::cache
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "fft.hpp"
+#include "tuning.hpp"
+
+namespace ra::cache {
+
+// Convolution flips the kernel, correlation slides it over the signal as is.
+enum class filter_mode { convolution, correlation };
+
+// Filters real signals with a fixed kernel of k values by overlap-save. The
+// signal is cut into overlapping segments of block_size() values, each
+// multiplied by the kernel spectrum in the frequency domain, and the last
+// block_size() - k + 1 values of each circular result are the linear ones.
+// The plan, kernel spectrum and segment buffers are kept between calls, so
+// filtering allocates nothing. T is the complex type of the spectra.
+// Throws std::invalid_argument for an empty kernel.
+template <class T, std::size_t Leaf = tuning<T>::fft_leaf>
+class convolver {
+public:
+  using value_type = typename T::value_type;
+
+  // block is rounded up to a power of two of at least 2k. The default of
+  // 8k keeps the overlap of k - 1 values a small part of each block.
+  convolver(const value_type *kernel, std::size_t k,
+            filter_mode mode = filter_mode::convolution, std::size_t block = 0)
+      : k_(checked_length(k)), plan_(block_length(k, block)),
+        segment_(plan_.size()),
+        spectrum_(plan_.size() / 2 + 1),
+        kernel_spectrum_(plan_.size() / 2 + 1) {
+    for (std::size_t i = 0; i < k; ++i) {
+      segment_[i] = kernel[mode == filter_mode::convolution ? i : k - 1 - i];
+    }
+    plan_.forward(segment_.data(), kernel_spectrum_.data());
+  }
+
+  std::size_t kernel_size() const { return k_; }
+
+  std::size_t block_size() const { return plan_.size(); }
+
+  // Writes the n + k - 1 values of the full convolution or correlation of
+  // the n values at x with the kernel to y. Output j of a correlation is
+  // the dot product of the kernel with x shifted by j - (k - 1).
+  void filter(const value_type *x, std::size_t n, value_type *y) {
+    std::size_t l = plan_.size();
+    std::size_t step = l - k_ + 1;
+    std::size_t total = n + k_ - 1;
+    for (std::size_t out = 0; out < total; out += step) {
+      // Segment of x from out - (k - 1) to out + step, zero outside [0, n)
+      std::size_t lead = out < k_ - 1 ? k_ - 1 - out : 0;
+      std::size_t begin = out + lead - (k_ - 1);
+      std::size_t count = begin < n ? std::min(l - lead, n - begin) : 0;
+      std::fill_n(segment_.begin(), lead, value_type(0));
+      if (count > 0) {
+        std::copy_n(x + begin, count, segment_.begin() + lead);
+      }
+      std::fill(segment_.begin() + lead + count, segment_.end(),
+                value_type(0));
+      plan_.forward(segment_.data(), spectrum_.data());
+      for (std::size_t i = 0; i < spectrum_.size(); ++i) {
+        spectrum_[i] *= kernel_spectrum_[i];
+      }
+      plan_.inverse(spectrum_.data(), segment_.data());
+      std::copy_n(segment_.data() + k_ - 1, std::min(step, total - out),
+                  y + out);
+    }
+  }
+
+private:
+  static std::size_t checked_length(std::size_t k) {
+    if (k == 0) {
+      throw std::invalid_argument("The kernel needs at least one value");
+    }
+    return k;
+  }
+
+  static std::size_t block_length(std::size_t k, std::size_t block) {
+    std::size_t wanted = std::max(block == 0 ? 8 * k : block, 2 * k);
+    std::size_t l = 2;
+    while (l < wanted) {
+      l *= 2;
+    }
+    return l;
+  }
+
+  std::size_t k_;
+  real_fft_plan<T, Leaf> plan_;
+  std::vector<value_type> segment_;
+  std::vector<T> spectrum_;
+  std::vector<T> kernel_spectrum_;
+};
+
+// Full convolution of the n values at a with the m values at b into the
+// n + m - 1 values at y. The shorter one is used as the kernel. The
+// result is empty, and nothing is written, if either operand is.
+template <class T, std::size_t Leaf = tuning<T>::fft_leaf>
+void fft_convolve(const typename T::value_type *a, std::size_t n,
+                  const typename T::value_type *b, std::size_t m,
+                  typename T::value_type *y) {
+  if (n == 0 || m == 0) {
+    return;
+  }
+  if (m > n) {
+    std::swap(a, b);
+    std::swap(n, m);
+  }
+  convolver<T, Leaf>(b, m).filter(a, n, y);
+}
+
+// Full cross-correlation of the n values at a with the m values at b into
+// the n + m - 1 values at y, for shifts of b from -(m - 1) to n - 1. The
+// result is empty, and nothing is written, if either operand is.
+template <class T, std::size_t Leaf = tuning<T>::fft_leaf>
+void fft_correlate(const typename T::value_type *a, std::size_t n,
+                   const typename T::value_type *b, std::size_t m,
+                   typename T::value_type *y) {
+  if (n == 0 || m == 0) {
+    return;
+  }
+  convolver<T, Leaf>(b, m, filter_mode::correlation).filter(a, n, y);
+}
+
+template <class V>
+void naive_convolve(const V *a, std::size_t n, const V *b, std::size_t m,
+                    V *y) {
+  std::fill_n(y, n + m - 1, V(0));
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = 0; j < m; ++j) {
+      y[i + j] += a[i] * b[j];
+    }
+  }
+}
+
+template <class V>
+void naive_correlate(const V *a, std::size_t n, const V *b, std::size_t m,
+                     V *y) {
+  std::fill_n(y, n + m - 1, V(0));
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = 0; j < m; ++j) {
+      y[i + m - 1 - j] += a[i] * b[j];
+    }
+  }
+}
+} // namespace ra::cache
@@ -1,14 +1,36 @@
+#pragma once
+
+#include <algorithm>
 #include <cstddef>
 #include <complex>
 #include <cmath>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
+#include "fft_kernels.hpp"
 #include "matrix_transpose.hpp"
+#include "thread_pool.hpp"
+#include "tuning.hpp"
 
 namespace ra::cache {
 
 template <class T>
 constexpr T pi = 3.14159265358979323846;
 
+// a * w with the product written out. std::complex multiplication checks
+// its result for NaN and recomputes it in a library call if so, which the
+// twiddle multiplications of a transform have no use for.
+template <class T> T mul_no_nan(const T& a, const T& w)
+{
+	return T(a.real() * w.real() - a.imag() * w.imag(),
+	         a.real() * w.imag() + a.imag() * w.real());
+}
+
 template <class T>
 std::unique_ptr<T[]> generate_random_vector(std::size_t n, int seed = 0xDEADBEEF) {
   static std::random_device dev;
@@ -24,20 +46,44 @@ std::unique_ptr<T[]> generate_random_vector(std::size_t n, int seed = 0xDEADBEEF
 	return v;
 };
 
+namespace {
+// n-th roots of unity w^k = exp(-2 pi i k / n) for k < n. Each is computed
+// directly rather than as a power of w, so errors do not accumulate. Integer
+// element types get the rounded values of the double precision roots.
+template <class T> std::unique_ptr<T[]> unit_roots(std::size_t n) {
+	using V = typename T::value_type;
+	using R = std::conditional_t<std::is_floating_point_v<V>, V, double>;
+	auto roots = std::make_unique<T[]>(n);
+	for (std::size_t k = 0; k < n; ++k) {
+		auto w = std::polar<R>(1, -2 * pi<R> * R(k) / R(n));
+		roots[k] = T(V(w.real()), V(w.imag()));
+	}
+	return roots;
+}
+
+// Radix-2 decimation in time on every stride-th element from x. The twiddle
+// of a size n node is w_n^k = roots[k * root_stride] for roots of a larger
+// transform. Odd lengths are computed directly as a DFT.
 template <class T>
-T* dit_fft(T* x, std::size_t n, int stride = 1)
+T* dit_fft_helper(const T* x, std::size_t n, std::size_t stride,
+                  const T* roots, std::size_t root_stride)
 {
-	if (n == 1) {
-		T* res = new T[1];
-		res[0] = x[0];
+	if (n % 2 == 1) {
+		T* res = new T[n];
+		for (std::size_t k = 0; k < n; ++k) {
+			res[k] = T(0);
+			for (std::size_t i = 0; i < n; ++i) {
+				res[k] += x[i * stride] * roots[k * i % n * root_stride];
+			}
+		}
 		return res;
 	}
-	T* lower = dit_fft(x, n/2, 2*stride);
-	T* upper = dit_fft(x+stride, n/2, 2*stride);
+	T* lower = dit_fft_helper(x, n/2, 2*stride, roots, 2*root_stride);
+	T* upper = dit_fft_helper(x+stride, n/2, 2*stride, roots, 2*root_stride);
 	T* res = new T[n];
 
-	for (int k = 0; k < n/2; ++k) {
-		T twiddle_factor = std::polar<typename T::value_type>(1.0, -2 * pi<typename T::value_type> * k / n) * upper[k];
+	for (std::size_t k = 0; k < n/2; ++k) {
+		T twiddle_factor = roots[k * root_stride] * upper[k];
 		res[k] = lower[k] + twiddle_factor;
 		res[k + n/2] = lower[k] - twiddle_factor;
 	}
@@ -47,55 +93,953 @@ T* dit_fft(T* x, std::size_t n, int stride = 1)
 	return res;
 }
 
+// Direct DFT of length P = 3, 5 or 7 in place, with w^k = roots[k]. Each
+// x[j] is paired with x[P - j], so that each output pair k, P - k shares
+// the products with the real and imaginary parts of w^(j * k).
+template <std::size_t P, class T> void prime_codelet(T* x, const T* roots) {
+	constexpr std::size_t h = (P - 1) / 2;
+	T x0 = x[0];
+	T sum[h];
+	T diff[h];
+	for (std::size_t j = 1; j <= h; ++j) {
+		sum[j - 1] = x[j] + x[P - j];
+		diff[j - 1] = x[j] - x[P - j];
+		x[0] += sum[j - 1];
+	}
+	for (std::size_t k = 1; k <= h; ++k) {
+		T re = x0;
+		T im(0);
+		for (std::size_t j = 1; j <= h; ++j) {
+			const T& w = roots[j * k % P];
+			re += sum[j - 1] * w.real();
+			im += diff[j - 1] * w.imag();
+		}
+		// re + i im and re - i im
+		x[k] = T(re.real() - im.imag(), re.imag() + im.real());
+		x[P - k] = T(re.real() + im.imag(), re.imag() - im.real());
+	}
+}
+
+// Sine and cosine by their Taylor series after reducing x to [-pi, pi],
+// usable in constant expressions. Accurate to long double rounding there.
+constexpr long double constexpr_sin(long double x) {
+	while (x > pi<long double>) {
+		x -= 2 * pi<long double>;
+	}
+	while (x < -pi<long double>) {
+		x += 2 * pi<long double>;
+	}
+	long double term = x;
+	long double sum = x;
+	for (int k = 1; k < 30; ++k) {
+		term *= -x * x / ((2 * k) * (2 * k + 1));
+		sum += term;
+	}
+	return sum;
+}
+
+constexpr long double constexpr_cos(long double x) {
+	return constexpr_sin(x + pi<long double> / 2);
+}
+
+// w_N^k = exp(-2 pi i k / N) for k < N / 2, the twiddles of the last
+// butterfly stage of a length N codelet
+template <std::size_t N> struct codelet_twiddles {
+	long double re[N / 2];
+	long double im[N / 2];
+
+	constexpr codelet_twiddles() : re(), im() {
+		for (std::size_t k = 0; k < N / 2; ++k) {
+			re[k] = constexpr_cos(-2 * pi<long double> * k / N);
+			im[k] = constexpr_sin(-2 * pi<long double> * k / N);
+		}
+	}
+};
+
+template <std::size_t N>
+constexpr codelet_twiddles<N> codelet_twiddle_table{};
+
+// Straight-line transforms of every stride-th element of x into out, for N
+// a power of two up to 64. The general case is one radix-2 stage over two
+// codelets of half the length, with its twiddles as constants. All lengths
+// are known at compile time, so the recursion and the loops unroll
+// completely, and the trivial twiddles 1 and -i need no multiply.
+template <std::size_t N> struct fft_codelet {
+	static_assert(N >= 8 && N <= 64 && (N & (N - 1)) == 0,
+	              "Codelets exist for powers of two up to 64");
+
+	template <class T>
+	static void apply(const T* x, std::size_t stride, T* out) {
+		using V = typename T::value_type;
+		constexpr std::size_t h = N / 2;
+		fft_codelet<h>::apply(x, 2 * stride, out);
+		fft_codelet<h>::apply(x + stride, 2 * stride, out + h);
+		for (std::size_t k = 0; k < h; ++k) {
+			T b = out[k + h];
+			T t = b;
+			if (4 * k == N) {
+				t = T(b.imag(), -b.real());
+			} else if (k > 0) {
+				V wr = V(codelet_twiddle_table<N>.re[k]);
+				V wi = V(codelet_twiddle_table<N>.im[k]);
+				t = T(b.real() * wr - b.imag() * wi, b.real() * wi + b.imag() * wr);
+			}
+			out[k + h] = out[k] - t;
+			out[k] += t;
+		}
+	}
+};
+
+template <> struct fft_codelet<1> {
+	template <class T>
+	static void apply(const T* x, std::size_t, T* out) {
+		out[0] = x[0];
+	}
+};
+
+template <> struct fft_codelet<2> {
+	template <class T>
+	static void apply(const T* x, std::size_t stride, T* out) {
+		out[0] = x[0] + x[stride];
+		out[1] = x[0] - x[stride];
+	}
+};
+
+template <> struct fft_codelet<4> {
+	template <class T>
+	static void apply(const T* x, std::size_t stride, T* out) {
+		T a = x[0] + x[2 * stride];
+		T b = x[0] - x[2 * stride];
+		T c = x[stride] + x[3 * stride];
+		T d = x[stride] - x[3 * stride];
+		out[0] = a + c;
+		out[2] = a - c;
+		// b - i d and b + i d
+		out[1] = T(b.real() + d.imag(), b.imag() - d.real());
+		out[3] = T(b.real() - d.imag(), b.imag() + d.real());
+	}
+};
+
+// In-place codelet transform of the N elements at x
+template <std::size_t N, class T> void power_codelet(T* x) {
+	T res[N];
+	fft_codelet<N>::apply(x, 1, res);
+	std::copy_n(res, N, x);
+}
+
+// Largest length with a power of two codelet
+constexpr std::size_t max_codelet = 64;
+
+// Divisor d of n that splits it into the most balanced n / d x d six-step
+// decomposition with d <= n / d, or 0 if n is prime. A d that also divides
+// n / d is preferred, since the in-place transposes of such shapes reduce to
+// square ones.
+inline std::size_t fft_split(std::size_t n) {
+	std::size_t d = 1;
+	while ((d + 1) * (d + 1) <= n) {
+		++d;
+	}
+	std::size_t balanced = 0;
+	for (; d > 1; --d) {
+		if (n % d != 0) {
+			continue;
+		}
+		if ((n / d) % d == 0) {
+			return d;
+		}
+		if (balanced == 0) {
+			balanced = d;
+		}
+	}
+	return balanced;
+}
+} // namespace
+
+// Precomputed tables for transforms of one length, reusable across any
+// number of transforms of that length. Each distinct length in the
+// recursion gets one node holding its roots of unity and, above the leaves,
+// the n2 x n1 twiddles of its six-step decomposition. Any factorization
+// n = n1 * n2 is accepted, so lengths such as 3 * 2^k recurse down to
+// codelets for 3, 5, 7 and powers of two. Primes are computed directly as a
+// DFT up to bluestein_threshold and by Bluestein's algorithm above it, as a
+// cyclic convolution of power of two length. Leaf bounds the length of the
+// transforms computed directly, by a codelet for powers of two up to
+// max_codelet and as a DFT otherwise.
+template <class T, std::size_t Leaf = tuning<T>::fft_leaf>
+class fft_plan {
+	static_assert(Leaf > 0, "The leaf DFT needs at least one element");
+
+public:
+	// Smallest prime length transformed with Bluestein's algorithm
+	static constexpr std::size_t bluestein_threshold = 64;
+
+	explicit fft_plan(std::size_t n) : root_(node_for(n)) {}
+
+	std::size_t size() const { return root_->n; }
+
+	// w^k = exp(-2 pi i k / n) for k < n
+	const T* roots() const { return root_->roots.get(); }
+
+	// Number of values of type T a plan for length n allocates: the tables
+	// of its levels and the scratch buffer of its largest Bluestein level,
+	// which exists during a transform. Computed without building the plan.
+	static std::size_t memory_size(std::size_t n) {
+		std::set<std::size_t> seen;
+		std::size_t scratch = 0;
+		std::size_t tables = table_size(n, seen, scratch);
+		return tables + scratch;
+	}
+
+	// In-place forward transform of size() elements at x
+	void forward(T* x) const { forward(*root_, x); }
+
+	// Parallel forward transform on a work-stealing pool. The sub-transform
+	// batches and the transposes of the six-step levels, with the twiddles
+	// applied after the first batch, are split across threads down to
+	// transforms of grain elements, which run sequentially.
+	void forward(T* x, thread_pool& pool, std::size_t grain = 1 << 14) const {
+		forward(*root_, x, pool, grain);
+	}
+
+	// In-place inverse transform, normalized so that it undoes forward. It
+	// is the conjugate of the forward transform of the conjugate.
+	void inverse(T* x) const {
+		using V = typename T::value_type;
+		std::size_t n = root_->n;
+		for (std::size_t i = 0; i < n; ++i) {
+			x[i] = std::conj(x[i]);
+		}
+		forward(*root_, x);
+		for (std::size_t i = 0; i < n; ++i) {
+			x[i] = std::conj(x[i]) / V(n);
+		}
+	}
+
+private:
+	enum class method { dft, codelet, six_step, bluestein };
+
+	struct node {
+		std::size_t n;
+		method how = method::dft;
+		std::size_t n1 = 0;
+		std::size_t n2 = 0;
+		std::unique_ptr<T[]> roots;
+		// w^(i * j) at i * n1 + j, for the n2 x n1 intermediate matrix
+		std::unique_ptr<T[]> twiddles;
+		// Bluestein's exp(-pi i k^2 / n) for k < n, and the transform of the
+		// convolution kernel, of length first->n
+		std::unique_ptr<T[]> chirp;
+		std::unique_ptr<T[]> kernel;
+		const node* first = nullptr;
+		const node* second = nullptr;
+	};
+
+	const node* node_for(std::size_t n) {
+		auto found = nodes_.find(n);
+		if (found != nodes_.end()) {
+			return found->second.get();
+		}
+		auto s = std::make_unique<node>();
+		s->n = n;
+		s->roots = unit_roots<T>(n);
+		s->how = method_for(n);
+		if (s->how == method::six_step) {
+			std::size_t d = fft_split(n);
+			s->n1 = n / d;
+			s->n2 = d;
+			s->twiddles = std::make_unique<T[]>(n);
+			for (std::size_t i = 0; i < s->n2; ++i) {
+				for (std::size_t j = 0; j < s->n1; ++j) {
+					s->twiddles[i * s->n1 + j] = s->roots[i * j % n];
+				}
+			}
+			s->first = node_for(s->n1);
+			s->second = node_for(s->n2);
+		} else if (s->how == method::bluestein) {
+			make_bluestein(*s);
+		}
+		return nodes_.emplace(n, std::move(s)).first->second.get();
+	}
+
+	static method method_for(std::size_t n) {
+		bool power = (n & (n - 1)) == 0;
+		if (n == 3 || n == 5 || n == 7 ||
+		    (power && n >= 2 && n <= std::min(Leaf, max_codelet))) {
+			return method::codelet;
+		} else if (n <= Leaf) {
+			return method::dft;
+		} else if (fft_split(n) != 0) {
+			return method::six_step;
+		} else if (n >= bluestein_threshold) {
+			return method::bluestein;
+		}
+		return method::dft;
+	}
+
+	// Power of two m >= 2n - 1 over which Bluestein's convolution is done
+	static std::size_t bluestein_length(std::size_t n) {
+		std::size_t m = 1;
+		while (m < 2 * n - 1) {
+			m *= 2;
+		}
+		return m;
+	}
+
+	// Table sizes of the nodes node_for would create for n and not yet in
+	// seen, tracking the largest Bluestein scratch buffer among them
+	static std::size_t table_size(std::size_t n, std::set<std::size_t>& seen,
+	                              std::size_t& scratch) {
+		if (!seen.insert(n).second) {
+			return 0;
+		}
+		std::size_t size = n;
+		switch (method_for(n)) {
+		case method::six_step: {
+			std::size_t d = fft_split(n);
+			size += n + table_size(n / d, seen, scratch) +
+			        table_size(d, seen, scratch);
+			break;
+		}
+		case method::bluestein: {
+			std::size_t m = bluestein_length(n);
+			scratch = std::max(scratch, m);
+			size += n + m + table_size(m, seen, scratch);
+			break;
+		}
+		default:
+			break;
+		}
+		return size;
+	}
+
+	// The DFT is a convolution of x_k c_k with the conjugate chirp c_k^*,
+	// scaled by c_k again, for c_k = exp(-pi i k^2 / n). The convolution is
+	// cyclic over a power of two m >= 2n - 1, so that it does not wrap.
+	void make_bluestein(node& s) {
+		using V = typename T::value_type;
+		using R = std::conditional_t<std::is_floating_point_v<V>, V, double>;
+		std::size_t n = s.n;
+		std::size_t m = bluestein_length(n);
+		s.chirp = std::make_unique<T[]>(n);
+		s.kernel = std::make_unique<T[]>(m);
+		for (std::size_t k = 0; k < n; ++k) {
+			// k^2 mod 2n keeps the angle small for large k
+			auto c = std::polar<R>(1, -pi<R> * R(k * k % (2 * n)) / R(n));
+			s.chirp[k] = T(V(c.real()), V(c.imag()));
+			s.kernel[k] = std::conj(s.chirp[k]);
+			if (k > 0) {
+				s.kernel[m - k] = s.kernel[k];
+			}
+		}
+		s.first = node_for(m);
+		forward(*s.first, s.kernel.get());
+	}
+
+	// Multiplies row i of the n2 x n1 matrix of a six-step level by its
+	// twiddles. Done right after the row is transformed, while it is still
+	// in cache, this saves a separate pass over x.
+	static void twiddle_row(const node& s, T* x, std::size_t i) {
+		std::size_t n1 = s.n1;
+		T* row = x + n1 * i;
+		const T* twiddles = s.twiddles.get() + n1 * i;
+		for (std::size_t j = 0; j < n1; ++j) {
+			row[j] = mul_no_nan(row[j], twiddles[j]);
+		}
+	}
+
+	static void forward(const node& s, T* x) {
+		std::size_t n = s.n;
+		switch (s.how) {
+		case method::codelet:
+			switch (n) {
+			case 2: power_codelet<2>(x); break;
+			case 4: power_codelet<4>(x); break;
+			case 8: power_codelet<8>(x); break;
+			case 16: power_codelet<16>(x); break;
+			case 32: power_codelet<32>(x); break;
+			case 64: power_codelet<64>(x); break;
+			case 3: prime_codelet<3>(x, s.roots.get()); break;
+			case 5: prime_codelet<5>(x, s.roots.get()); break;
+			case 7: prime_codelet<7>(x, s.roots.get()); break;
+			}
+			return;
+		case method::dft:
+			dft(s, x);
+			return;
+		case method::bluestein:
+			bluestein(s, x);
+			return;
+		case method::six_step:
+			break;
+		}
+
+		std::size_t n1 = s.n1;
+		std::size_t n2 = s.n2;
+		matrix_transpose<T>(x, n1, n2, x);
+
+		for (std::size_t i = 0; i < n2; ++i) {
+			forward(*s.first, x + n1 * i);
+			twiddle_row(s, x, i);
+		}
+
+		matrix_transpose<T>(x, n2, n1, x);
+
+		for (std::size_t i = 0; i < n1; ++i) {
+			forward(*s.second, x + n2 * i);
+		}
+
+		matrix_transpose<T>(x, n1, n2, x);
+	}
+
+	static void forward(const node& s, T* x, thread_pool& pool,
+	                    std::size_t grain) {
+		std::size_t n = s.n;
+		if (s.how != method::six_step || n <= grain || pool.size() == 1) {
+			forward(s, x);
+			return;
+		}
+
+		std::size_t n1 = s.n1;
+		std::size_t n2 = s.n2;
+		matrix_transpose<T>(x, n1, n2, x, pool, grain);
+
+		pool.parallel_for(0, n2, std::max<std::size_t>(grain / n1, 1),
+		                  [&](std::size_t i) {
+			forward(*s.first, x + n1 * i, pool, grain);
+			twiddle_row(s, x, i);
+		});
+
+		matrix_transpose<T>(x, n2, n1, x, pool, grain);
+
+		pool.parallel_for(0, n1, std::max<std::size_t>(grain / n2, 1),
+		                  [&](std::size_t i) {
+			forward(*s.second, x + n2 * i, pool, grain);
+		});
+
+		matrix_transpose<T>(x, n1, n2, x, pool, grain);
+	}
+
+	// Leaves, and primes below bluestein_threshold
+	static void dft(const node& s, T* x) {
+		std::size_t n = s.n;
+		T res[std::max(Leaf, bluestein_threshold)];
+		for (std::size_t k = 0; k < n; ++k) {
+			res[k] = T(0);
+			// Index of w^(k * i), stepped by k modulo n
+			std::size_t r = 0;
+			for (std::size_t i = 0; i < n; ++i) {
+				res[k] += x[i] * s.roots[r];
+				r += k;
+				if (r >= n) {
+					r -= n;
+				}
+			}
+		}
+		std::copy_n(res, n, x);
+	}
+
+	// The inverse transform of the convolution is taken as the conjugate of
+	// the forward transform of the conjugate.
+	static void bluestein(const node& s, T* x) {
+		using V = typename T::value_type;
+		std::size_t n = s.n;
+		std::size_t m = s.first->n;
+		auto y = std::make_unique<T[]>(m);
+		for (std::size_t k = 0; k < n; ++k) {
+			y[k] = x[k] * s.chirp[k];
+		}
+		forward(*s.first, y.get());
+		for (std::size_t k = 0; k < m; ++k) {
+			y[k] = std::conj(y[k] * s.kernel[k]);
+		}
+		forward(*s.first, y.get());
+		for (std::size_t k = 0; k < n; ++k) {
+			x[k] = std::conj(y[k]) * s.chirp[k] / V(m);
+		}
+	}
+
+	// Nodes by length, each owned here and referenced by its parents
+	std::map<std::size_t, std::unique_ptr<node>> nodes_;
+	const node* root_;
+};
+
 template <class T>
-void naive_fft(T* x, std::size_t n)
+T* dit_fft(T* x, std::size_t n, int stride = 1)
 {
-	T* res = dit_fft(x, n);
-	for (int i = 0; i < n; ++i) {
-		x[i] = res[i];
+	return dit_fft_helper<T>(x, n, stride, unit_roots<T>(n).get(), 1);
+}
+
+// Iterative radix-4 FFT in place for n a power of two, the RAM model
+// baseline. The input is permuted into bit-reversed order, after which each
+// pass of radix-4 butterflies merges four transforms of length m into one
+// of length 4m, preceded by a single radix-2 pass when log2(n) is odd.
+// Nothing is allocated; twiddles are computed per butterfly group.
+template <class T>
+void iterative_fft(T* x, std::size_t n)
+{
+	using V = typename T::value_type;
+	using R = std::conditional_t<std::is_floating_point_v<V>, V, double>;
+
+	for (std::size_t i = 1, j = 0; i < n; ++i) {
+		std::size_t bit = n >> 1;
+		for (; j & bit; bit >>= 1) {
+			j ^= bit;
+		}
+		j ^= bit;
+		if (i < j) {
+			std::swap(x[i], x[j]);
+		}
+	}
+
+	std::size_t m = 1;
+	std::size_t log_n = 0;
+	while (std::size_t(2) << log_n <= n) {
+		++log_n;
+	}
+	if (log_n % 2 == 1) {
+		for (std::size_t i = 0; i < n; i += 2) {
+			T a = x[i];
+			x[i] = a + x[i + 1];
+			x[i + 1] = a - x[i + 1];
+		}
+		m = 2;
+	}
+
+	const T minus_i(V(0), V(-1));
+	for (; 4 * m <= n; m *= 4) {
+		for (std::size_t j = 0; j < m; ++j) {
+			auto w = std::polar<R>(1, -2 * pi<R> * R(j) / R(4 * m));
+			T w1(V(w.real()), V(w.imag()));
+			T w2 = w1 * w1;
+			T w3 = w2 * w1;
+			for (std::size_t k = j; k < n; k += 4 * m) {
+				T a = x[k];
+				T b = x[k + m] * w2;
+				T c = x[k + 2 * m] * w1;
+				T d = x[k + 3 * m] * w3;
+				T ab_sum = a + b;
+				T ab_diff = a - b;
+				T cd_sum = c + d;
+				T cd_diff = minus_i * (c - d);
+				x[k] = ab_sum + cd_sum;
+				x[k + m] = ab_diff + cd_diff;
+				x[k + 2 * m] = ab_sum - cd_sum;
+				x[k + 3 * m] = ab_diff - cd_diff;
+			}
+		}
 	}
-	delete[] res;
 }
 
+// Lengths other than powers of two go through dit_fft.
 template <class T>
+void naive_fft(T* x, std::size_t n)
+{
+	if ((n & (n - 1)) == 0) {
+		iterative_fft(x, n);
+		return;
+	}
+	std::unique_ptr<T[]> res(dit_fft(x, n));
+	std::copy_n(res.get(), n, x);
+}
+
+// Builds a plan for a single transform; keep an fft_plan to transform many
+// vectors of the same length.
+template <class T, std::size_t Leaf = tuning<T>::fft_leaf>
 void forward_fft(T* x, std::size_t n)
 {
-	if (n <= 4) {
-		auto base_twiddle_factor = std::polar<typename T::value_type>(1.0, -2 * pi<typename T::value_type> / n);
-		auto res = std::make_unique<T[]>(n);
-		for (int k = 0; k < n; ++k) {
-			for (int i = 0; i < n; ++i) {
-				res[k] += x[i] * std::pow<typename T::value_type>(base_twiddle_factor, std::complex<typename T::value_type>(k*i));
+	fft_plan<T, Leaf>(n).forward(x);
+}
+
+// Parallel transform on a work-stealing pool, see fft_plan::forward
+template <class T, std::size_t Leaf = tuning<T>::fft_leaf>
+void forward_fft(T* x, std::size_t n, thread_pool& pool,
+                 std::size_t grain = 1 << 14)
+{
+	fft_plan<T, Leaf>(n).forward(x, pool, grain);
+}
+
+template <class T, std::size_t Leaf = tuning<T>::fft_leaf>
+void forward_fft(T* x, std::size_t n, std::size_t threads)
+{
+	thread_pool pool(threads);
+	forward_fft<T, Leaf>(x, n, pool);
+}
+
+template <class T, std::size_t Leaf = tuning<T>::fft_leaf>
+void inverse_fft(T* x, std::size_t n)
+{
+	fft_plan<T, Leaf>(n).inverse(x);
+}
+
+// Conversions between arrays of std::complex and the split layout, with the
+// real and imaginary parts in separate arrays
+template <class V>
+void deinterleave(const std::complex<V>* x, std::size_t n, V* re, V* im)
+{
+	for (std::size_t i = 0; i < n; ++i) {
+		re[i] = x[i].real();
+		im[i] = x[i].imag();
+	}
+}
+
+template <class V>
+void interleave(const V* re, const V* im, std::size_t n, std::complex<V>* x)
+{
+	for (std::size_t i = 0; i < n; ++i) {
+		x[i] = std::complex<V>(re[i], im[i]);
+	}
+}
+
+// Transforms in the split layout, where complex multiplies need no shuffles
+// and vectorize across consecutive elements. Powers of two up to Leaf are
+// done by iterative radix-2 passes over the bit-reversed input, with one
+// contiguous twiddle table per pass. Longer ones use the six-step
+// recursion of fft_plan, transposing the real and imaginary parts
+// separately. Other lengths are interleaved into a buffer and go through
+// fft_plan.
+template <class V, std::size_t Leaf = tuning<V>::split_fft_leaf>
+class split_fft_plan {
+	static_assert(std::is_floating_point_v<V>,
+	              "The split layout needs a real floating point type");
+	static_assert(Leaf > 1 && (Leaf & (Leaf - 1)) == 0,
+	              "Leaf must be a power of two");
+
+public:
+	explicit split_fft_plan(std::size_t n) : n_(n) {
+		if (n > 0 && (n & (n - 1)) == 0) {
+			root_ = node_for(n);
+		} else {
+			fallback_ = std::make_unique<fft_plan<std::complex<V>>>(n);
+		}
+	}
+
+	std::size_t size() const { return n_; }
+
+	// In-place forward transform of the size() elements with real parts at
+	// re and imaginary parts at im
+	void forward(V* re, V* im) const {
+		if (root_ != nullptr) {
+			forward(*root_, re, im);
+			return;
+		}
+		auto x = std::make_unique<std::complex<V>[]>(n_);
+		interleave(re, im, n_, x.get());
+		fallback_->forward(x.get());
+		deinterleave(x.get(), n_, re, im);
+	}
+
+	// Normalized inverse. Exchanging the real and imaginary parts before
+	// and after the forward transform conjugates it, which costs nothing in
+	// this layout.
+	void inverse(V* re, V* im) const {
+		forward(im, re);
+		V scale = V(1) / V(n_);
+		for (std::size_t i = 0; i < n_; ++i) {
+			re[i] *= scale;
+			im[i] *= scale;
+		}
+	}
+
+private:
+	struct node {
+		std::size_t n;
+		std::size_t n1 = 0;
+		std::size_t n2 = 0;
+		// For iterative passes, w_(2m)^j at m + j for the pass merging
+		// transforms of length m. Above the leaves, the six-step twiddles
+		// w^(i * j) at i * n1 + j.
+		std::unique_ptr<V[]> wr;
+		std::unique_ptr<V[]> wi;
+		const node* first = nullptr;
+		const node* second = nullptr;
+	};
+
+	const node* node_for(std::size_t n) {
+		auto found = nodes_.find(n);
+		if (found != nodes_.end()) {
+			return found->second.get();
+		}
+		auto s = std::make_unique<node>();
+		s->n = n;
+		s->wr = std::make_unique<V[]>(n);
+		s->wi = std::make_unique<V[]>(n);
+		auto roots = unit_roots<std::complex<V>>(n);
+		if (n <= Leaf) {
+			for (std::size_t m = 1; m < n; m *= 2) {
+				for (std::size_t j = 0; j < m; ++j) {
+					s->wr[m + j] = roots[j * (n / (2 * m))].real();
+					s->wi[m + j] = roots[j * (n / (2 * m))].imag();
+				}
+			}
+		} else {
+			s->n2 = fft_split(n);
+			s->n1 = n / s->n2;
+			for (std::size_t i = 0; i < s->n2; ++i) {
+				for (std::size_t j = 0; j < s->n1; ++j) {
+					s->wr[i * s->n1 + j] = roots[i * j % n].real();
+					s->wi[i * s->n1 + j] = roots[i * j % n].imag();
+				}
+			}
+			s->first = node_for(s->n1);
+			s->second = node_for(s->n2);
+		}
+		return nodes_.emplace(n, std::move(s)).first->second.get();
+	}
+
+	static void forward(const node& s, V* re, V* im) {
+		std::size_t n = s.n;
+		if (n <= Leaf) {
+			for (std::size_t i = 1, j = 0; i < n; ++i) {
+				std::size_t bit = n >> 1;
+				for (; j & bit; bit >>= 1) {
+					j ^= bit;
+				}
+				j ^= bit;
+				if (i < j) {
+					std::swap(re[i], re[j]);
+					std::swap(im[i], im[j]);
+				}
 			}
+			for (std::size_t m = 1; m < n; m *= 2) {
+				for (std::size_t k = 0; k < n; k += 2 * m) {
+					split_butterflies(re + k, im + k, re + k + m, im + k + m,
+					                  s.wr.get() + m, s.wi.get() + m, m);
+				}
+			}
+			return;
 		}
-		for (int i = 0; i < n; ++i) {
-			x[i] = res[i];
+
+		std::size_t n1 = s.n1;
+		std::size_t n2 = s.n2;
+		matrix_transpose<V>(re, n1, n2, re);
+		matrix_transpose<V>(im, n1, n2, im);
+
+		for (std::size_t i = 0; i < n2; ++i) {
+			forward(*s.first, re + n1 * i, im + n1 * i);
+		}
+
+		split_multiply(re, im, s.wr.get(), s.wi.get(), n);
+
+		matrix_transpose<V>(re, n2, n1, re);
+		matrix_transpose<V>(im, n2, n1, im);
+
+		for (std::size_t i = 0; i < n1; ++i) {
+			forward(*s.second, re + n2 * i, im + n2 * i);
+		}
+
+		matrix_transpose<V>(re, n1, n2, re);
+		matrix_transpose<V>(im, n1, n2, im);
+	}
+
+	std::size_t n_;
+	std::map<std::size_t, std::unique_ptr<node>> nodes_;
+	const node* root_ = nullptr;
+	std::unique_ptr<fft_plan<std::complex<V>>> fallback_;
+};
+
+// Transforms of arrays of any number of dimensions in row-major order,
+// one axis at a time. Each pass transforms every row along the contiguous
+// last axis and then transposes the array, viewed as a matrix of those
+// rows, so that the next axis becomes contiguous. After one pass per axis
+// the axes are back in their original order.
+template <class T, std::size_t Leaf = tuning<T>::fft_leaf>
+class multi_fft_plan {
+public:
+	explicit multi_fft_plan(std::vector<std::size_t> dims)
+	    : dims_(std::move(dims)), size_(1) {
+		for (std::size_t d : dims_) {
+			size_ *= d;
+			if (plans_.find(d) == plans_.end()) {
+				plans_.emplace(d, std::make_unique<fft_plan<T, Leaf>>(d));
+			}
 		}
-		return;
 	}
 
-	int n1 = std::pow(2, std::ceil(std::log2(n)/2));
-	int n2 = std::pow(2, std::floor(std::log2(n)/2));
+	const std::vector<std::size_t>& dims() const { return dims_; }
 
-	matrix_transpose<T>(x, n1, n2, x);
+	std::size_t size() const { return size_; }
 
-	for (int i = 0; i < n2; ++i) {
-		forward_fft<T>(x + n1 * i, n1);
+	void forward(T* x) const {
+		if (size_ == 0) {
+			// Arrays with an empty axis hold nothing to transform
+			return;
+		}
+		for (std::size_t a = dims_.size(); a-- > 0;) {
+			std::size_t d = dims_[a];
+			const fft_plan<T, Leaf>& plan = *plans_.at(d);
+			for (std::size_t i = 0; i < size_; i += d) {
+				plan.forward(x + i);
+			}
+			matrix_transpose<T>(x, size_ / d, d, x);
+		}
 	}
 
-	T base_twiddle_factor = std::polar<typename T::value_type>(1.0, 2 * pi<typename T::value_type> / n);
-	for (int i = 0; i < n2; ++i) {
-		for (int j = 0; j < n1; ++j) {
-			x[j + n1 * i] *= std::pow<typename T::value_type>(base_twiddle_factor, std::complex<typename T::value_type>(-i*j));
+	// Normalized inverse. The conjugations and the scaling are done once
+	// for the whole array rather than once per axis.
+	void inverse(T* x) const {
+		using V = typename T::value_type;
+		for (std::size_t i = 0; i < size_; ++i) {
+			x[i] = std::conj(x[i]);
+		}
+		forward(x);
+		for (std::size_t i = 0; i < size_; ++i) {
+			x[i] = std::conj(x[i]) / V(size_);
 		}
 	}
 
-	matrix_transpose<T>(x, n2, n1, x);
+private:
+	std::vector<std::size_t> dims_;
+	std::size_t size_;
+	// One plan per distinct length, shared by the axes of that length
+	std::map<std::size_t, std::unique_ptr<fft_plan<T, Leaf>>> plans_;
+};
+
+// Transform of the rows x cols matrix at x
+template <class T, std::size_t Leaf = tuning<T>::fft_leaf>
+void forward_fft_2d(T* x, std::size_t rows, std::size_t cols)
+{
+	multi_fft_plan<T, Leaf>({rows, cols}).forward(x);
+}
 
-	for (int i = 0; i < n1; ++i) {
-		forward_fft<T>(x + n2 * i, n2);
+template <class T, std::size_t Leaf = tuning<T>::fft_leaf>
+void inverse_fft_2d(T* x, std::size_t rows, std::size_t cols)
+{
+	multi_fft_plan<T, Leaf>({rows, cols}).inverse(x);
+}
+
+// Transform of the d0 x d1 x d2 array at x, with d2 contiguous
+template <class T, std::size_t Leaf = tuning<T>::fft_leaf>
+void forward_fft_3d(T* x, std::size_t d0, std::size_t d1, std::size_t d2)
+{
+	multi_fft_plan<T, Leaf>({d0, d1, d2}).forward(x);
+}
+
+template <class T, std::size_t Leaf = tuning<T>::fft_leaf>
+void inverse_fft_3d(T* x, std::size_t d0, std::size_t d1, std::size_t d2)
+{
+	multi_fft_plan<T, Leaf>({d0, d1, d2}).inverse(x);
+}
+
+// Transforms of n real values, whose spectra are Hermitian and so given by
+// their n / 2 + 1 leading elements. For even n the real values are packed
+// pairwise into n / 2 complex ones, which go through the half length
+// fft_plan, and the spectrum is separated into that of the even and odd
+// elements afterwards. Odd n go through the complex transform of length n.
+template <class T, std::size_t Leaf = tuning<T>::fft_leaf>
+class real_fft_plan {
+public:
+	using value_type = typename T::value_type;
+
+	explicit real_fft_plan(std::size_t n)
+	    : n_(n), complex_(n % 2 == 0 ? n / 2 : n) {
+		if (n % 2 == 0) {
+			twiddles_ = unit_roots<T>(n);
+		}
+	}
+
+	std::size_t size() const { return n_; }
+
+	// Writes the n / 2 + 1 leading elements of the spectrum of the size()
+	// values at x to out.
+	void forward(const value_type* x, T* out) const {
+		if (n_ % 2 == 1) {
+			auto y = std::make_unique<T[]>(n_);
+			for (std::size_t i = 0; i < n_; ++i) {
+				y[i] = T(x[i], value_type(0));
+			}
+			complex_.forward(y.get());
+			std::copy_n(y.get(), n_ / 2 + 1, out);
+			return;
+		}
+
+		std::size_t h = n_ / 2;
+		for (std::size_t i = 0; i < h; ++i) {
+			out[i] = T(x[2 * i], x[2 * i + 1]);
+		}
+		complex_.forward(out);
+
+		// With E and O the transforms of the even and odd elements, the
+		// packed transform is Z = E + i O and X_k = E_k + w^k O_k.
+		T z0 = out[0];
+		out[0] = T(z0.real() + z0.imag(), value_type(0));
+		out[h] = T(z0.real() - z0.imag(), value_type(0));
+		for (std::size_t k = 1; k <= h / 2; ++k) {
+			T a = out[k];
+			T b = out[h - k];
+			out[k] = separate(a, b, twiddles_[k]);
+			out[h - k] = separate(b, a, twiddles_[h - k]);
+		}
+	}
+
+	// Writes the size() real values whose spectrum has the n / 2 + 1 leading
+	// elements at in to x, so that inverse undoes forward. in is overwritten.
+	void inverse(T* in, value_type* x) const {
+		if (n_ % 2 == 1) {
+			auto y = std::make_unique<T[]>(n_);
+			for (std::size_t k = 0; k < n_; ++k) {
+				y[k] = std::conj(k <= n_ / 2 ? in[k] : std::conj(in[n_ - k]));
+			}
+			complex_.forward(y.get());
+			for (std::size_t i = 0; i < n_; ++i) {
+				x[i] = y[i].real() / value_type(n_);
+			}
+			return;
+		}
+
+		// Undoes the separation above, then takes the inverse half length
+		// transform as the conjugate of the forward one of the conjugate
+		std::size_t h = n_ / 2;
+		T x0 = in[0];
+		T xh = in[h];
+		in[0] = std::conj(combine(x0, std::conj(xh), T(1)));
+		for (std::size_t k = 1; k <= h / 2; ++k) {
+			T a = in[k];
+			T b = in[h - k];
+			in[k] = std::conj(combine(a, std::conj(b), twiddles_[k]));
+			in[h - k] = std::conj(combine(b, std::conj(a), twiddles_[h - k]));
+		}
+		complex_.forward(in);
+		for (std::size_t i = 0; i < h; ++i) {
+			x[2 * i] = in[i].real() / value_type(h);
+			x[2 * i + 1] = -in[i].imag() / value_type(h);
+		}
+	}
+
+private:
+	// X_k from a = Z_k and b = Z_(h-k), as E_k = (a + b*) / 2 and
+	// O_k = -i (a - b*) / 2
+	static T separate(const T& a, const T& b, const T& w) {
+		T even = (a + std::conj(b)) / value_type(2);
+		T odd = (a - std::conj(b)) / value_type(2);
+		return even + w * T(odd.imag(), -odd.real());
 	}
 
-	matrix_transpose<T>(x, n1, n2, x);
+	// Z_k = E_k + i O_k from a = X_k and c = X_(h-k)* = E_k - w^k O_k
+	static T combine(const T& a, const T& c, const T& w) {
+		T even = (a + c) / value_type(2);
+		T odd = (a - c) / value_type(2) * std::conj(w);
+		return even + T(-odd.imag(), odd.real());
+	}
+
+	std::size_t n_;
+	fft_plan<T, Leaf> complex_;
+	// w^k = exp(-2 pi i k / n), for even n
+	std::unique_ptr<T[]> twiddles_;
+};
+
+// Real to complex transform of the n values at x into the n / 2 + 1 leading
+// elements of their spectrum at out
+template <class T, std::size_t Leaf = tuning<T>::fft_leaf>
+void forward_real_fft(const typename T::value_type* x, std::size_t n, T* out)
+{
+	real_fft_plan<T, Leaf>(n).forward(x, out);
+}
+
+// Complex to real transform, the inverse of forward_real_fft. in is
+// overwritten.
+template <class T, std::size_t Leaf = tuning<T>::fft_leaf>
+void inverse_real_fft(T* in, std::size_t n, typename T::value_type* x)
+{
+	real_fft_plan<T, Leaf>(n).inverse(in, x);
 }
 }
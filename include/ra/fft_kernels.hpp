@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace ra::cache {
+
+// Vector operations used by the split complex FFT on arrays of real or
+// imaginary parts of type V. lanes is the number of elements held by one
+// register. The primary template has no vector support (lanes == 0), in
+// which case callers fall back to the scalar loop.
+template <class V> struct fft_ops {
+  static constexpr std::size_t lanes = 0;
+};
+
+#if defined(__AVX2__) && defined(__FMA__)
+template <> struct fft_ops<float> {
+  using reg = __m256;
+  static constexpr std::size_t lanes = 8;
+  static reg load(const float *p) { return _mm256_loadu_ps(p); }
+  static void store(float *p, reg a) { _mm256_storeu_ps(p, a); }
+  static reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+  static reg sub(reg a, reg b) { return _mm256_sub_ps(a, b); }
+  static reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+  // a * b + c and a * b - c
+  static reg madd(reg a, reg b, reg c) { return _mm256_fmadd_ps(a, b, c); }
+  static reg msub(reg a, reg b, reg c) { return _mm256_fmsub_ps(a, b, c); }
+};
+
+template <> struct fft_ops<double> {
+  using reg = __m256d;
+  static constexpr std::size_t lanes = 4;
+  static reg load(const double *p) { return _mm256_loadu_pd(p); }
+  static void store(double *p, reg a) { _mm256_storeu_pd(p, a); }
+  static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+  static reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+  static reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+  static reg madd(reg a, reg b, reg c) { return _mm256_fmadd_pd(a, b, c); }
+  static reg msub(reg a, reg b, reg c) { return _mm256_fmsub_pd(a, b, c); }
+};
+#endif
+
+// Radix-2 butterflies of one pass, x_j += w_j y_j and y_j = x_j - w_j y_j
+// for j < m, with the real and imaginary parts of x, y and w in separate
+// arrays. Runs of lanes butterflies share one register per operand.
+template <class V>
+void split_butterflies(V *xr, V *xi, V *yr, V *yi, const V *wr, const V *wi,
+                       std::size_t m) {
+  std::size_t j = 0;
+  if constexpr (fft_ops<V>::lanes > 0) {
+    using ops = fft_ops<V>;
+    for (; j + ops::lanes <= m; j += ops::lanes) {
+      auto ar = ops::load(xr + j);
+      auto ai = ops::load(xi + j);
+      auto br = ops::load(yr + j);
+      auto bi = ops::load(yi + j);
+      auto cr = ops::load(wr + j);
+      auto ci = ops::load(wi + j);
+      auto tr = ops::msub(br, cr, ops::mul(bi, ci));
+      auto ti = ops::madd(br, ci, ops::mul(bi, cr));
+      ops::store(xr + j, ops::add(ar, tr));
+      ops::store(xi + j, ops::add(ai, ti));
+      ops::store(yr + j, ops::sub(ar, tr));
+      ops::store(yi + j, ops::sub(ai, ti));
+    }
+  }
+  for (; j < m; ++j) {
+    V tr = yr[j] * wr[j] - yi[j] * wi[j];
+    V ti = yr[j] * wi[j] + yi[j] * wr[j];
+    yr[j] = xr[j] - tr;
+    yi[j] = xi[j] - ti;
+    xr[j] += tr;
+    xi[j] += ti;
+  }
+}
+
+// x_j *= w_j for j < n, in split layout
+template <class V>
+void split_multiply(V *xr, V *xi, const V *wr, const V *wi, std::size_t n) {
+  std::size_t j = 0;
+  if constexpr (fft_ops<V>::lanes > 0) {
+    using ops = fft_ops<V>;
+    for (; j + ops::lanes <= n; j += ops::lanes) {
+      auto ar = ops::load(xr + j);
+      auto ai = ops::load(xi + j);
+      auto cr = ops::load(wr + j);
+      auto ci = ops::load(wi + j);
+      ops::store(xr + j, ops::msub(ar, cr, ops::mul(ai, ci)));
+      ops::store(xi + j, ops::madd(ar, ci, ops::mul(ai, cr)));
+    }
+  }
+  for (; j < n; ++j) {
+    V r = xr[j] * wr[j] - xi[j] * wi[j];
+    xi[j] = xr[j] * wi[j] + xi[j] * wr[j];
+    xr[j] = r;
+  }
+}
+} // namespace ra::cache
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include "matrix_multiply.hpp"
+#include "triangular_solve.hpp"
+#include "tuning.hpp"
+
+namespace ra::cache {
+
+namespace {
+// Swaps row i with row pivots[i] for i in [begin, end), over the n columns
+// starting at a
+template <class T>
+void swap_rows(T *a, std::size_t lda, std::size_t n, const std::size_t *pivots,
+               std::size_t begin, std::size_t end) {
+  for (std::size_t i = begin; i < end; ++i) {
+    if (pivots[i] != i) {
+      std::swap_ranges(a + i * lda, a + i * lda + n, a + pivots[i] * lda);
+    }
+  }
+}
+
+// Row-oriented Gaussian elimination with partial pivoting on the m x n
+// matrix at a. Whole rows of the panel are swapped and updated one pivot at
+// a time.
+template <class T>
+bool lu_factor_rows(T *a, std::size_t lda, std::size_t m, std::size_t n,
+                    std::size_t *pivots) {
+  bool regular = true;
+  std::size_t k_end = std::min(m, n);
+  for (std::size_t k = 0; k < k_end; ++k) {
+    std::size_t pivot = k;
+    for (std::size_t i = k + 1; i < m; ++i) {
+      if (std::abs(a[i * lda + k]) > std::abs(a[pivot * lda + k])) {
+        pivot = i;
+      }
+    }
+    pivots[k] = pivot;
+    if (pivot != k) {
+      std::swap_ranges(a + k * lda, a + k * lda + n, a + pivot * lda);
+    }
+
+    T d = a[k * lda + k];
+    if (d == T(0)) {
+      regular = false;
+      continue;
+    }
+    for (std::size_t i = k + 1; i < m; ++i) {
+      T l = a[i * lda + k] /= d;
+      scaled_row_add(a + i * lda + k + 1, a + k * lda + k + 1, -l, n - k - 1);
+    }
+  }
+  return regular;
+}
+
+// Splits the columns in half, factors the left panel, applies its row swaps
+// and eliminations to the right half and factors what remains of it. The
+// elimination is a triangular solve followed by a multiply, which is where
+// nearly all of the work happens.
+template <std::size_t Leaf, class T>
+bool lu_factor_helper(T *a, std::size_t lda, std::size_t m, std::size_t n,
+                      std::size_t *pivots) {
+  std::size_t k = std::min(m, n);
+  if (n <= Leaf || k < 2) {
+    return lu_factor_rows(a, lda, m, n, pivots);
+  }
+
+  std::size_t n1 = k / 2;
+  std::size_t n2 = n - n1;
+  T *a12 = a + n1;
+  T *a21 = a + n1 * lda;
+  T *a22 = a21 + n1;
+  bool regular = lu_factor_helper<Leaf>(a, lda, m, n1, pivots);
+  swap_rows(a12, lda, n2, pivots, 0, n1);
+  triangular_solve<T, Leaf>(matrix_side::left, matrix_triangle::lower,
+                            matrix_op::none, matrix_diagonal::unit, n1, n2, a,
+                            lda, a12, lda);
+  gemm(matrix_op::none, matrix_op::none, m - n1, n1, n2, T(-1), a21, lda, a12,
+       lda, T(1), a22, lda);
+  regular &= lu_factor_helper<Leaf>(a22, lda, m - n1, n2, pivots + n1);
+  for (std::size_t i = n1; i < k; ++i) {
+    pivots[i] += n1;
+  }
+  swap_rows(a, lda, n1, pivots, n1, k);
+  return regular;
+}
+} // namespace
+
+// Factors the m x n matrix a with row length lda as P a = L U, overwriting a
+// with the unit lower triangular L below the diagonal and U on and above it.
+// pivots receives min(m, n) row indices: row i was swapped with row
+// pivots[i], in order of i. Returns false if a pivot was zero, in which case
+// U is singular but the factorization is still complete.
+template <class T, std::size_t Leaf = tuning<T>::solve_leaf>
+bool lu_factor(T *a, std::size_t lda, std::size_t m, std::size_t n,
+               std::size_t *pivots) {
+  return lu_factor_helper<Leaf>(a, lda, m, n, pivots);
+}
+
+template <class T>
+bool naive_lu_factor(T *a, std::size_t lda, std::size_t m, std::size_t n,
+                     std::size_t *pivots) {
+  return lu_factor_rows(a, lda, m, n, pivots);
+}
+
+// Solves a x = b for the n x nrhs matrix b, given the factorization of the
+// n x n matrix a from lu_factor. b is overwritten with x.
+template <class T, std::size_t Leaf = tuning<T>::solve_leaf>
+void lu_solve(const T *lu, std::size_t lda, std::size_t n,
+              const std::size_t *pivots, T *b, std::size_t ldb,
+              std::size_t nrhs) {
+  swap_rows(b, ldb, nrhs, pivots, 0, n);
+  triangular_solve<T, Leaf>(matrix_side::left, matrix_triangle::lower,
+                            matrix_op::none, matrix_diagonal::unit, n, nrhs,
+                            lu, lda, b, ldb);
+  triangular_solve<T, Leaf>(matrix_side::left, matrix_triangle::upper,
+                            matrix_op::none, matrix_diagonal::non_unit, n,
+                            nrhs, lu, lda, b, ldb);
+}
+} // namespace ra::cache
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <algorithm>
+#include <complex>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "fft.hpp"
+#include "mapped_transpose.hpp"
+#include "matrix_transpose.hpp"
+#include "tuning.hpp"
+
+namespace ra::cache {
+
+namespace {
+// Columns per block of a pass over a matrix of the given rows and total
+// columns, at most limit. Blocks are transposed in place, which takes
+// square blocks when one of rows and the block width divides the other and
+// a slow cycle permutation otherwise, so such a width that also divides
+// total is taken if there is one above half of limit.
+inline std::size_t block_columns(std::size_t limit, std::size_t rows,
+                                 std::size_t total) {
+  limit = std::min(limit, total);
+  for (std::size_t c = limit; c > limit / 2; --c) {
+    if (total % c == 0 && (rows % c == 0 || c % rows == 0)) {
+      return c;
+    }
+  }
+  return limit;
+}
+} // namespace
+
+// Forward transform of the n complex values stored in the file in into the
+// file out, for signals too large to hold in memory. The six-step split
+// n = n1 n2 of fft_plan is done as two passes over the mapped files, each
+// working on one buffer. The buffer, the plans for n1 and n2 and the
+// twiddle tables together take at most memory bytes:
+//
+// 1. Blocks of columns of the n1 x n2 input are gathered into the buffer
+//    and transposed, transformed as rows of length n1, multiplied by the
+//    twiddles and written to out as consecutive rows of an n2 x n1 matrix.
+// 2. Blocks of columns of that matrix are gathered, transposed, transformed
+//    as rows of length n2 and transposed back into the same columns, which
+//    is where the final transpose puts them.
+//
+// Both passes read and write whole row segments, so the page cache sees
+// runs of about memory / max(n1, n2) bytes. Signals that fit in memory
+// together with their plan are transformed in one piece. Throws
+// std::invalid_argument if in and out name the same file, if in holds
+// fewer than n values, or if n has no split that leaves room for a row of
+// length n1 in the buffer, as for large primes. Throws std::system_error
+// if a file cannot be mapped.
+template <class T, std::size_t Leaf = tuning<T>::fft_leaf>
+void forward_fft_file(const std::string &in, std::size_t n,
+                      const std::string &out, std::size_t memory = 1 << 28,
+                      map_advice advice = map_advice::normal) {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Mapped signals must be trivially copyable");
+  using V = typename T::value_type;
+  using R = std::conditional_t<std::is_floating_point_v<V>, V, double>;
+  using plan = fft_plan<T, Leaf>;
+  mapped_file a(in);
+  if (a.same_file(out)) {
+    throw std::invalid_argument("Cannot transform a file onto itself");
+  }
+  if (a.size() < n * sizeof(T)) {
+    throw std::invalid_argument("Input file is smaller than the signal");
+  }
+
+  // The buffer gets what the plans and twiddle tables leave of memory
+  bool whole = (n + plan::memory_size(n)) * sizeof(T) <= memory;
+  std::size_t d = whole ? 0 : fft_split(n);
+  std::size_t n1 = d == 0 ? n : n / d;
+  std::size_t n2 = d == 0 ? 1 : d;
+  std::size_t budget = 0;
+  if (!whole && d != 0) {
+    std::size_t tables =
+        (plan::memory_size(n1) + plan::memory_size(n2)) * sizeof(T) +
+        (n1 + n2) * sizeof(std::complex<R>);
+    budget = memory > tables ? (memory - tables) / sizeof(T) : 0;
+  }
+  if (!whole && budget < n1) {
+    throw std::invalid_argument("Signal cannot be split within the memory");
+  }
+  mapped_file b(out, n * sizeof(T));
+  a.advise(advice);
+  b.advise(advice);
+  const T *x = static_cast<const T *>(a.data());
+  T *y = static_cast<T *>(b.data());
+
+  if (whole) {
+    std::vector<T> buffer(x, x + n);
+    plan(n).forward(buffer.data());
+    std::copy(buffer.begin(), buffer.end(), y);
+    b.sync();
+    return;
+  }
+
+  // The twiddle w_n^k for k = q n2 + r < n is w_n1^q w_n^r, from two tables
+  // of n1 and n2 roots instead of one of n
+  auto coarse = unit_roots<std::complex<R>>(n1);
+  std::vector<std::complex<R>> fine(n2);
+  for (std::size_t r = 0; r < n2; ++r) {
+    fine[r] = std::polar<R>(1, -2 * pi<R> * R(r) / R(n));
+  }
+
+  plan first(n1);
+  plan second(n2);
+  std::vector<T> buffer(std::min(budget, n));
+  T *block = buffer.data();
+
+  std::size_t cols = block_columns(budget / n1, n1, n2);
+  for (std::size_t c0 = 0; c0 < n2; c0 += cols) {
+    std::size_t c = std::min(cols, n2 - c0);
+    for (std::size_t i = 0; i < n1; ++i) {
+      std::copy_n(x + i * n2 + c0, c, block + i * c);
+    }
+    matrix_transpose<T>(block, n1, c, block);
+    for (std::size_t i = 0; i < c; ++i) {
+      T *row = block + i * n1;
+      first.forward(row);
+      // Row c0 + i < n2 takes w_n^k for k = (c0 + i) j, stepped as
+      // q n2 + r
+      std::size_t step = c0 + i;
+      std::size_t q = 0;
+      std::size_t r = 0;
+      for (std::size_t j = 0; j < n1; ++j) {
+        std::complex<R> v(R(row[j].real()), R(row[j].imag()));
+        v = mul_no_nan(v, mul_no_nan(coarse[q], fine[r]));
+        row[j] = T(V(v.real()), V(v.imag()));
+        r += step;
+        if (r >= n2) {
+          r -= n2;
+          ++q;
+        }
+      }
+    }
+    std::copy_n(block, c * n1, y + c0 * n1);
+  }
+
+  cols = block_columns(budget / n2, n2, n1);
+  for (std::size_t c0 = 0; c0 < n1; c0 += cols) {
+    std::size_t c = std::min(cols, n1 - c0);
+    for (std::size_t i = 0; i < n2; ++i) {
+      std::copy_n(y + i * n1 + c0, c, block + i * c);
+    }
+    matrix_transpose<T>(block, n2, c, block);
+    for (std::size_t i = 0; i < c; ++i) {
+      second.forward(block + i * n2);
+    }
+    matrix_transpose<T>(block, c, n2, block);
+    for (std::size_t i = 0; i < n2; ++i) {
+      std::copy_n(block + i * c, c, y + i * n1 + c0);
+    }
+  }
+  b.sync();
+}
+} // namespace ra::cache
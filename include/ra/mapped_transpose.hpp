@@ -0,0 +1,185 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include "matrix_transpose.hpp"
+#include "tuning.hpp"
+
+namespace ra::cache {
+
+// Access pattern hints passed on to madvise
+enum class map_advice { normal, sequential, random, will_need, huge_page };
+
+// Shared mapping of a whole file. Throws std::system_error if the file
+// cannot be opened, resized or mapped.
+class mapped_file {
+public:
+  // Maps an existing file read-only
+  explicit mapped_file(const std::string &path) {
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+      fail("open " + path);
+    }
+    struct stat st;
+    if (::fstat(fd_, &st) != 0) {
+      fail("stat " + path);
+    }
+    map(static_cast<std::size_t>(st.st_size), PROT_READ);
+  }
+
+  // Creates or truncates the file to size bytes and maps it read-write
+  mapped_file(const std::string &path, std::size_t size) {
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+      fail("open " + path);
+    }
+    if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+      fail("truncate " + path);
+    }
+    map(size, PROT_READ | PROT_WRITE);
+  }
+
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+
+  ~mapped_file() { release(); }
+
+  void *data() const { return data_; }
+  std::size_t size() const { return size_; }
+
+  // Whether path names the mapped file, under whatever spelling or link.
+  // Checked before opening path for writing, which would truncate it.
+  bool same_file(const std::string &path) const {
+    struct stat mine;
+    struct stat other;
+    if (::stat(path.c_str(), &other) != 0) {
+      return false;
+    }
+    return ::fstat(fd_, &mine) == 0 && mine.st_dev == other.st_dev &&
+           mine.st_ino == other.st_ino;
+  }
+
+  void advise(map_advice advice) {
+    if (data_ == nullptr) {
+      return;
+    }
+    int flag = MADV_NORMAL;
+    switch (advice) {
+    case map_advice::normal:
+      flag = MADV_NORMAL;
+      break;
+    case map_advice::sequential:
+      flag = MADV_SEQUENTIAL;
+      break;
+    case map_advice::random:
+      flag = MADV_RANDOM;
+      break;
+    case map_advice::will_need:
+      flag = MADV_WILLNEED;
+      break;
+    case map_advice::huge_page:
+#ifdef MADV_HUGEPAGE
+      flag = MADV_HUGEPAGE;
+#endif
+      break;
+    }
+    // Only a hint, failure is not an error
+    ::madvise(data_, size_, flag);
+  }
+
+  // Writes dirty pages back to the file
+  void sync() {
+    if (data_ != nullptr && ::msync(data_, size_, MS_SYNC) != 0) {
+      fail("msync");
+    }
+  }
+
+private:
+  void map(std::size_t size, int protection) {
+    size_ = size;
+    if (size == 0) {
+      // mmap rejects empty mappings
+      return;
+    }
+    void *data = ::mmap(nullptr, size, protection, MAP_SHARED, fd_, 0);
+    if (data == MAP_FAILED) {
+      fail("mmap");
+    }
+    data_ = data;
+  }
+
+  void release() {
+    if (data_ != nullptr) {
+      ::munmap(data_, size_);
+      data_ = nullptr;
+    }
+    if (fd_ >= 0) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+  }
+
+  // The destructor does not run for a throwing constructor, so clean up here
+  [[noreturn]] void fail(const std::string &what) {
+    int error = errno;
+    release();
+    throw std::system_error(error, std::generic_category(), what);
+  }
+
+  int fd_ = -1;
+  void *data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+namespace {
+template <class T, class F>
+void transpose_file(const std::string &in, std::size_t m, std::size_t n,
+                    const std::string &out, map_advice advice, F transpose) {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Mapped matrices must be trivially copyable");
+  mapped_file a(in);
+  if (a.same_file(out)) {
+    throw std::invalid_argument("Cannot transpose a file onto itself");
+  }
+  if (a.size() < m * n * sizeof(T)) {
+    throw std::invalid_argument("Input file is smaller than the matrix");
+  }
+  mapped_file b(out, m * n * sizeof(T));
+  a.advise(advice);
+  b.advise(advice);
+  transpose(static_cast<const T *>(a.data()), static_cast<T *>(b.data()));
+  b.sync();
+}
+} // namespace
+
+// Transposes the row-major m x n matrix stored in the file in into the file
+// out. Both files are mapped so that the page cache plays the role of the
+// ideal cache for the recursive decomposition.
+template <class T, std::size_t Leaf = tuning<T>::transpose_leaf>
+void matrix_transpose_file(const std::string &in, std::size_t m,
+                           std::size_t n, const std::string &out,
+                           map_advice advice = map_advice::normal) {
+  transpose_file<T>(in, m, n, out, advice, [m, n](const T *a, T *b) {
+    matrix_transpose<T, Leaf>(a, m, n, b);
+  });
+}
+
+template <class T>
+void naive_matrix_transpose_file(const std::string &in, std::size_t m,
+                                 std::size_t n, const std::string &out,
+                                 map_advice advice = map_advice::normal) {
+  transpose_file<T>(in, m, n, out, advice, [m, n](const T *a, T *b) {
+    naive_matrix_transpose(a, m, n, b);
+  });
+}
+} // namespace ra::cache
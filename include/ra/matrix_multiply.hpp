@@ -1,6 +1,17 @@
+#pragma once
+
 #include <algorithm>
+#include <limits>
 #include <random>
 #include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <unistd.h>
+
+#include "multiply_kernels.hpp"
+#include "thread_pool.hpp"
+#include "transpose_kernels.hpp"
+#include "tuning.hpp"
 
 namespace ra::cache {
 
@@ -32,49 +43,733 @@ std::unique_ptr<T> copy_matrix(T *a, std::size_t m, std::size_t n) {
   return b;
 }
 
-template <class T>
-void matrix_multiply_helper(const T *a, const T *b, std::size_t m_orig,
-                            std::size_t n_orig, std::size_t p_orig,
-                            std::size_t m, std::size_t n, std::size_t p, T *c) {
-  if (m * n * p <= 64) {
-    // Base case
-    for (int i = 0; i < m; ++i) {
-      for (int k = 0; k < p; ++k) {
-        T sum(0);
-        for (int j = 0; j < n; ++j) {
-          sum += a[i * n_orig + j] * b[j * p_orig + k];
-        }
-        c[i * p_orig + k] += sum;
+// Scalar base case, c += a * b on blocks with products and sums in the
+// type of c
+template <class T, class U>
+void multiply_scalar(const T *a, const T *b, std::size_t lda, std::size_t ldb,
+                     std::size_t ldc, std::size_t m, std::size_t n,
+                     std::size_t p, U *c) {
+  for (std::size_t i = 0; i < m; ++i) {
+    for (std::size_t k = 0; k < p; ++k) {
+      U sum(0);
+      for (std::size_t j = 0; j < n; ++j) {
+        sum += U(a[i * lda + j]) * U(b[j * ldb + k]);
+      }
+      c[i * ldc + k] += sum;
+    }
+  }
+}
+
+// Covers the block of c with register kernels where T has one, leaving the
+// ragged right and bottom edges to the scalar loop.
+template <class T, class U>
+void multiply_block(const T *a, const T *b, std::size_t lda, std::size_t ldb,
+                    std::size_t ldc, std::size_t m, std::size_t n,
+                    std::size_t p, U *c) {
+  using kernel = multiply_kernel<T, U>;
+  std::size_t i = 0;
+  if constexpr (kernel::mr > 0) {
+    for (; i + kernel::mr <= m; i += kernel::mr) {
+      std::size_t k = 0;
+      for (; k + kernel::nr <= p; k += kernel::nr) {
+        kernel::run(n, a + i * lda, lda, b + k, ldb, c + i * ldc + k, ldc);
       }
+      multiply_scalar(a + i * lda, b + k, lda, ldb, ldc, kernel::mr, n, p - k,
+                      c + i * ldc + k);
     }
+  }
+  multiply_scalar(a + i * lda, b, lda, ldb, ldc, m - i, n, p, c + i * ldc);
+}
+
+// Split point for halving m or p, rounded down to a multiple of the kernel
+// block so that only the edges of the whole matrix miss the kernel.
+inline std::size_t kernel_half(std::size_t m, std::size_t block) {
+  if (block == 0 || m < 2 * block) {
+    return m / 2;
+  }
+  return m / 2 / block * block;
+}
+
+// Multiplies the m x n block at a with the n x p block at b and adds the
+// result to the m x p block at c. lda, ldb and ldc are the row lengths of
+// the matrices the blocks live in.
+template <std::size_t Leaf, class T, class U>
+void matrix_multiply_helper(const T *a, const T *b, std::size_t lda,
+                            std::size_t ldb, std::size_t ldc, std::size_t m,
+                            std::size_t n, std::size_t p, U *c) {
+  if (m * n * p <= Leaf) {
+    multiply_block(a, b, lda, ldb, ldc, m, n, p, c);
 		return;
   }
 
   if (m == std::max({m, n, p})) {
     // Halve m
-    std::size_t m_half = m / 2;
-    matrix_multiply_helper(a, b, m_orig, n_orig, p_orig, m_half, n, p, c);
-    matrix_multiply_helper(a + m_half * n_orig, b, m_orig, n_orig, p_orig,
-                           m - m_half, n, p, c + m_half * p_orig);
+    std::size_t m_half = kernel_half(m, multiply_kernel<T, U>::mr);
+    matrix_multiply_helper<Leaf>(a, b, lda, ldb, ldc, m_half, n, p, c);
+    matrix_multiply_helper<Leaf>(a + m_half * lda, b, lda, ldb, ldc,
+                                 m - m_half, n, p, c + m_half * ldc);
   } else if (n == std::max({m, n, p})) {
     // Halve n
     std::size_t n_half = n / 2;
-    matrix_multiply_helper(a, b, m_orig, n_orig, p_orig, m, n_half, p, c);
-    matrix_multiply_helper(a + n_half, b + n_half * p_orig, m_orig, n_orig,
-                           p_orig, m, n - n_half, p, c);
+    matrix_multiply_helper<Leaf>(a, b, lda, ldb, ldc, m, n_half, p, c);
+    matrix_multiply_helper<Leaf>(a + n_half, b + n_half * ldb, lda, ldb, ldc,
+                                 m, n - n_half, p, c);
   } else {
     // Halve p
-    std::size_t p_half = p / 2;
-    matrix_multiply_helper(a, b, m_orig, n_orig, p_orig, m, n, p_half, c);
-    matrix_multiply_helper(a, b + p_half, m_orig, n_orig, p_orig, m, n,
-                           p - p_half, c + p_half);
+    std::size_t p_half = kernel_half(p, multiply_kernel<T, U>::nr);
+    matrix_multiply_helper<Leaf>(a, b, lda, ldb, ldc, m, n, p_half, c);
+    matrix_multiply_helper<Leaf>(a, b + p_half, lda, ldb, ldc, m, n,
+                                 p - p_half, c + p_half);
   }
 }
 
-template <class T>
+namespace {
+// Whether U holds every value of T, and so the products and sums formed in
+// U of inputs of type T, up to overflow of U. Integer types go to wider
+// ones of the same or a signed kind and to floating point types with as
+// many digits, floating point types only to wider floating point ones.
+template <class T, class U> constexpr bool widens_to() {
+  if constexpr (std::is_arithmetic_v<T> && std::is_arithmetic_v<U>) {
+    using t = std::numeric_limits<T>;
+    using u = std::numeric_limits<U>;
+    if (std::is_floating_point_v<T> && !std::is_floating_point_v<U>) {
+      return false;
+    }
+    return u::digits >= t::digits && u::max_exponent >= t::max_exponent &&
+           (std::is_signed_v<U> || !std::is_signed_v<T>);
+  } else {
+    return std::is_same_v<T, U>;
+  }
+}
+
+// Halving n makes both halves accumulate into the same block of c. Below
+// this many elements of c, the second half accumulates into a temporary so
+// that the halves can run in parallel; larger blocks run them in sequence,
+// which still leaves their m and p splits to the pool.
+constexpr std::size_t multiply_temporary_limit = 1 << 16;
+
+template <std::size_t Leaf, class T>
+void parallel_multiply_helper(thread_pool &pool, std::size_t grain,
+                              const T *a, const T *b, std::size_t lda,
+                              std::size_t ldb, std::size_t ldc, std::size_t m,
+                              std::size_t n, std::size_t p, T *c) {
+  if (m * n * p <= grain) {
+    matrix_multiply_helper<Leaf>(a, b, lda, ldb, ldc, m, n, p, c);
+    return;
+  }
+
+  if (m == std::max({m, n, p})) {
+    std::size_t m_half = kernel_half(m, multiply_kernel<T>::mr);
+    pool.fork_join(
+        [&] {
+          parallel_multiply_helper<Leaf>(pool, grain, a, b, lda, ldb, ldc,
+                                         m_half, n, p, c);
+        },
+        [&] {
+          parallel_multiply_helper<Leaf>(pool, grain, a + m_half * lda, b, lda,
+                                         ldb, ldc, m - m_half, n, p,
+                                         c + m_half * ldc);
+        });
+  } else if (n == std::max({m, n, p})) {
+    std::size_t n_half = n / 2;
+    auto first = [&] {
+      parallel_multiply_helper<Leaf>(pool, grain, a, b, lda, ldb, ldc, m,
+                                     n_half, p, c);
+    };
+    if (pool.size() == 1 || m * p > multiply_temporary_limit) {
+      first();
+      parallel_multiply_helper<Leaf>(pool, grain, a + n_half, b + n_half * ldb,
+                                     lda, ldb, ldc, m, n - n_half, p, c);
+      return;
+    }
+    auto tmp = std::make_unique<T[]>(m * p);
+    pool.fork_join(first, [&] {
+      parallel_multiply_helper<Leaf>(pool, grain, a + n_half, b + n_half * ldb,
+                                     lda, ldb, p, m, n - n_half, p, tmp.get());
+    });
+    for (std::size_t i = 0; i < m; ++i) {
+      for (std::size_t k = 0; k < p; ++k) {
+        c[i * ldc + k] += tmp[i * p + k];
+      }
+    }
+  } else {
+    std::size_t p_half = kernel_half(p, multiply_kernel<T>::nr);
+    pool.fork_join(
+        [&] {
+          parallel_multiply_helper<Leaf>(pool, grain, a, b, lda, ldb, ldc, m,
+                                         n, p_half, c);
+        },
+        [&] {
+          parallel_multiply_helper<Leaf>(pool, grain, a, b + p_half, lda, ldb,
+                                         ldc, m, n, p - p_half, c + p_half);
+        });
+  }
+}
+} // namespace
+
+// Leaf bounds the number of multiply-adds m * n * p of a base case. c may
+// have a wider type U than the inputs, in which case products and sums are
+// formed in U, such as int8 inputs accumulated in int32.
+template <class T, std::size_t Leaf = tuning<T>::multiply_leaf, class U>
 void matrix_multiply(const T *a, const T *b, std::size_t m, std::size_t n,
-                     std::size_t p, T *c) {
-  matrix_multiply_helper(a, b, m, n, p, m, n, p, c);
+                     std::size_t p, U *c) {
+  static_assert(widens_to<T, U>(),
+                "The type of c must hold products of the inputs");
+  matrix_multiply_helper<Leaf>(a, b, n, p, p, m, n, p, c);
+}
+
+// Parallel multiply on a work-stealing pool. Subproblems of at most grain
+// multiply-adds are not split across threads any further.
+template <class T, std::size_t Leaf = tuning<T>::multiply_leaf>
+void matrix_multiply(const T *a, const T *b, std::size_t m, std::size_t n,
+                     std::size_t p, T *c, thread_pool &pool,
+                     std::size_t grain = 1 << 18) {
+  parallel_multiply_helper<Leaf>(pool, grain, a, b, n, p, p, m, n, p, c);
+}
+
+template <class T, std::size_t Leaf = tuning<T>::multiply_leaf>
+void matrix_multiply(const T *a, const T *b, std::size_t m, std::size_t n,
+                     std::size_t p, T *c, std::size_t threads) {
+  thread_pool pool(threads);
+  matrix_multiply<T, Leaf>(a, b, m, n, p, c, pool);
+}
+
+// Data cache capacities in bytes, per core for L1 and L2
+struct cache_sizes {
+  std::size_t l1;
+  std::size_t l2;
+  std::size_t l3;
+};
+
+// Cache sizes reported by the C library, falling back to typical sizes for
+// levels it does not know about. Queried once.
+inline cache_sizes detect_cache_sizes() {
+  static const cache_sizes sizes = [] {
+    cache_sizes s = {32 << 10, 1 << 20, 8 << 20};
+#if defined(_SC_LEVEL1_DCACHE_SIZE) && defined(_SC_LEVEL2_CACHE_SIZE) &&       \
+    defined(_SC_LEVEL3_CACHE_SIZE)
+    long l1 = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+    long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (l1 > 0) {
+      s.l1 = l1;
+    }
+    if (l2 > 0) {
+      s.l2 = l2;
+    }
+    if (l3 > 0) {
+      s.l3 = l3;
+    }
+#endif
+    return s;
+  }();
+  return sizes;
+}
+
+// Loop blocking of packed_matrix_multiply: an mc x kc block of a and a
+// kc x nc block of b are packed at a time
+struct packed_blocking {
+  std::size_t mc;
+  std::size_t kc;
+  std::size_t nc;
+};
+
+namespace {
+// Register block of the packed multiply. Types without a kernel use a small
+// scalar one over the same packed layout.
+template <class T, class U> struct packed_micro {
+  using kernel = multiply_kernel<T, U>;
+  static constexpr std::size_t mr = kernel::mr > 0 ? kernel::mr : 4;
+  static constexpr std::size_t nr = kernel::nr > 0 ? kernel::nr : 4;
+
+  static void run(std::size_t kc, const T *a, const T *b, U *c,
+                  std::size_t ldc) {
+    if constexpr (kernel::mr > 0) {
+      kernel::run(kc, a, kc, b, nr, c, ldc);
+    } else {
+      multiply_scalar(a, b, kc, nr, ldc, mr, kc, nr, c);
+    }
+  }
+};
+
+// Copies the m x kc block at a into row-major micro-panels of mr rows,
+// zero-padding the last one
+template <std::size_t Mr, class T>
+void pack_rows(const T *a, std::size_t lda, std::size_t m, std::size_t kc,
+               T *out) {
+  for (std::size_t i = 0; i < m; i += Mr) {
+    std::size_t rows = std::min(Mr, m - i);
+    for (std::size_t r = 0; r < rows; ++r) {
+      std::copy_n(a + (i + r) * lda, kc, out + r * kc);
+    }
+    std::fill(out + rows * kc, out + Mr * kc, T(0));
+    out += Mr * kc;
+  }
+}
+
+// Copies the kc x p block at b into micro-panels of nr columns, each
+// row-major kc x nr, zero-padding the last one
+template <std::size_t Nr, class T>
+void pack_columns(const T *b, std::size_t ldb, std::size_t kc, std::size_t p,
+                  T *out) {
+  for (std::size_t k = 0; k < p; k += Nr) {
+    std::size_t cols = std::min(Nr, p - k);
+    for (std::size_t j = 0; j < kc; ++j) {
+      std::copy_n(b + j * ldb + k, cols, out + j * Nr);
+      std::fill(out + j * Nr + cols, out + (j + 1) * Nr, T(0));
+    }
+    out += kc * Nr;
+  }
+}
+
+inline std::size_t round_down(std::size_t x, std::size_t multiple) {
+  return std::max(multiple, x / multiple * multiple);
+}
+
+inline std::size_t round_up(std::size_t x, std::size_t multiple) {
+  return (x + multiple - 1) / multiple * multiple;
+}
+} // namespace
+
+// Block sizes for the given caches: a micro-panel of a and one of b fill
+// half of L1, the packed block of a half of L2 and that of b half of L3,
+// leaving the rest for c and whatever streams past.
+template <class T, class U = T>
+packed_blocking make_packed_blocking(const cache_sizes &caches) {
+  using micro = packed_micro<T, U>;
+  std::size_t kc = round_down(
+      caches.l1 / 2 / ((micro::mr + micro::nr) * sizeof(T)), 8);
+  std::size_t mc = round_down(caches.l2 / 2 / (kc * sizeof(T)), micro::mr);
+  std::size_t nc = round_down(caches.l3 / 2 / (kc * sizeof(T)), micro::nr);
+  return {mc, kc, nc};
+}
+
+// Cache-aware multiply, c += a * b, in the manner of Goto and BLIS: the
+// loops are blocked by the given sizes and both blocks are packed into
+// contiguous micro-panels, so that the register kernel reads a from L2 and
+// b from L1 at unit stride. The cache-aware counterpart of matrix_multiply.
+// mc and nc are rounded up to multiples of the register block. Throws
+// std::invalid_argument if a block size is zero.
+template <class T, class U>
+void packed_matrix_multiply(const T *a, const T *b, std::size_t m,
+                            std::size_t n, std::size_t p, U *c,
+                            const packed_blocking &blocking) {
+  static_assert(widens_to<T, U>(),
+                "The type of c must hold products of the inputs");
+  if (m == 0 || n == 0 || p == 0) {
+    return;
+  }
+  if (blocking.mc == 0 || blocking.kc == 0 || blocking.nc == 0) {
+    throw std::invalid_argument("Block sizes must be positive");
+  }
+  using micro = packed_micro<T, U>;
+  constexpr std::size_t mr = micro::mr;
+  constexpr std::size_t nr = micro::nr;
+  // Packing fills whole micro-panels, so blocks are whole numbers of them
+  std::size_t mc = round_up(std::min(blocking.mc, m), mr);
+  std::size_t kc = std::min(blocking.kc, n);
+  std::size_t nc = round_up(std::min(blocking.nc, p), nr);
+  auto packed_a = std::make_unique<T[]>(mc * kc);
+  auto packed_b = std::make_unique<T[]>(kc * nc);
+  U edge[mr * nr];
+
+  for (std::size_t jc = 0; jc < p; jc += nc) {
+    std::size_t p_block = std::min(nc, p - jc);
+    for (std::size_t pc = 0; pc < n; pc += kc) {
+      std::size_t n_block = std::min(kc, n - pc);
+      pack_columns<nr>(b + pc * p + jc, p, n_block, p_block, packed_b.get());
+      for (std::size_t ic = 0; ic < m; ic += mc) {
+        std::size_t m_block = std::min(mc, m - ic);
+        pack_rows<mr>(a + ic * n + pc, n, m_block, n_block, packed_a.get());
+        for (std::size_t jr = 0; jr < p_block; jr += nr) {
+          const T *panel_b = packed_b.get() + jr * n_block;
+          std::size_t cols = std::min(nr, p_block - jr);
+          for (std::size_t ir = 0; ir < m_block; ir += mr) {
+            const T *panel_a = packed_a.get() + ir * n_block;
+            std::size_t rows = std::min(mr, m_block - ir);
+            U *c_tile = c + (ic + ir) * p + jc + jr;
+            if (rows == mr && cols == nr) {
+              micro::run(n_block, panel_a, panel_b, c_tile, p);
+              continue;
+            }
+            // Edge tiles go through a full-size buffer
+            std::fill_n(edge, mr * nr, U(0));
+            micro::run(n_block, panel_a, panel_b, edge, nr);
+            for (std::size_t i = 0; i < rows; ++i) {
+              for (std::size_t k = 0; k < cols; ++k) {
+                c_tile[i * p + k] += edge[i * nr + k];
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// Blocked for the caches of the machine it runs on
+template <class T, class U>
+void packed_matrix_multiply(const T *a, const T *b, std::size_t m,
+                            std::size_t n, std::size_t p, U *c) {
+  packed_matrix_multiply(a, b, m, n, p, c,
+                         make_packed_blocking<T, U>(detect_cache_sizes()));
+}
+
+namespace {
+// z = x + y on m x n blocks
+template <class T>
+void add_blocks(const T *x, std::size_t ldx, const T *y, std::size_t ldy,
+                std::size_t m, std::size_t n, T *z, std::size_t ldz) {
+  for (std::size_t i = 0; i < m; ++i) {
+    for (std::size_t j = 0; j < n; ++j) {
+      z[i * ldz + j] = x[i * ldx + j] + y[i * ldy + j];
+    }
+  }
+}
+
+// z = x - y on m x n blocks, z may alias x or y
+template <class T>
+void subtract_blocks(const T *x, std::size_t ldx, const T *y, std::size_t ldy,
+                     std::size_t m, std::size_t n, T *z, std::size_t ldz) {
+  for (std::size_t i = 0; i < m; ++i) {
+    for (std::size_t j = 0; j < n; ++j) {
+      z[i * ldz + j] = x[i * ldx + j] - y[i * ldy + j];
+    }
+  }
+}
+
+// c += q on m x n blocks
+template <class T>
+void accumulate_block(const T *q, std::size_t ldq, std::size_t m,
+                      std::size_t n, T *c, std::size_t ldc) {
+  for (std::size_t i = 0; i < m; ++i) {
+    for (std::size_t j = 0; j < n; ++j) {
+      c[i * ldc + j] += q[i * ldq + j];
+    }
+  }
+}
+
+// Elements of workspace the Strassen recursion needs for an m x n x p
+// problem. Each level takes three temporaries and the seven products run one
+// after the other, so the levels stack rather than multiply.
+template <std::size_t Threshold>
+std::size_t strassen_workspace(std::size_t m, std::size_t n, std::size_t p) {
+  std::size_t size = 0;
+  while (std::min({m, n, p}) > Threshold) {
+    m /= 2;
+    n /= 2;
+    p /= 2;
+    size += m * n + n * p + m * p;
+  }
+  return size;
+}
+
+// Strassen-Winograd on the even part of the blocks, c += a * b. Odd rows,
+// columns and inner indices are peeled off and done classically. work points
+// at the unused part of the workspace.
+template <std::size_t Threshold, std::size_t Leaf, class T>
+void strassen_helper(const T *a, const T *b, std::size_t lda, std::size_t ldb,
+                     std::size_t ldc, std::size_t m, std::size_t n,
+                     std::size_t p, T *c, T *work) {
+  if (std::min({m, n, p}) <= Threshold) {
+    matrix_multiply_helper<Leaf>(a, b, lda, ldb, ldc, m, n, p, c);
+    return;
+  }
+
+  std::size_t m2 = m / 2;
+  std::size_t n2 = n / 2;
+  std::size_t p2 = p / 2;
+  if (m % 2 != 0) {
+    matrix_multiply_helper<Leaf>(a + (m - 1) * lda, b, lda, ldb, ldc, 1, n, p,
+                                 c + (m - 1) * ldc);
+  }
+  if (p % 2 != 0) {
+    matrix_multiply_helper<Leaf>(a, b + p - 1, lda, ldb, ldc, 2 * m2, n, 1,
+                                 c + p - 1);
+  }
+  if (n % 2 != 0) {
+    matrix_multiply_helper<Leaf>(a + n - 1, b + (n - 1) * ldb, lda, ldb, ldc,
+                                 2 * m2, 1, 2 * p2, c);
+  }
+
+  const T *a11 = a;
+  const T *a12 = a + n2;
+  const T *a21 = a + m2 * lda;
+  const T *a22 = a21 + n2;
+  const T *b11 = b;
+  const T *b12 = b + p2;
+  const T *b21 = b + n2 * ldb;
+  const T *b22 = b21 + p2;
+  T *c11 = c;
+  T *c12 = c + p2;
+  T *c21 = c + m2 * ldc;
+  T *c22 = c21 + p2;
+
+  // x holds the sums of a, y those of b and q a product shared by several
+  // quadrants of c
+  T *x = work;
+  T *y = x + m2 * n2;
+  T *q = y + n2 * p2;
+  T *rest = q + m2 * p2;
+  auto multiply = [&](const T *l, std::size_t ldl, const T *r,
+                      std::size_t ldr, T *out, std::size_t ldo) {
+    strassen_helper<Threshold, Leaf>(l, r, ldl, ldr, ldo, m2, n2, p2, out,
+                                     rest);
+  };
+
+  // P5 = (a21 + a22)(b12 - b11) goes to c12 and c22
+  add_blocks(a21, lda, a22, lda, m2, n2, x, n2);
+  subtract_blocks(b12, ldb, b11, ldb, n2, p2, y, p2);
+  std::fill(q, q + m2 * p2, T(0));
+  multiply(x, n2, y, p2, q, p2);
+  accumulate_block(q, p2, m2, p2, c12, ldc);
+  accumulate_block(q, p2, m2, p2, c22, ldc);
+
+  // P1 = a11 b11 goes to c11, P1 + P6 to c12, c21 and c22
+  subtract_blocks(x, n2, a11, lda, m2, n2, x, n2);
+  subtract_blocks(b22, ldb, y, p2, n2, p2, y, p2);
+  std::fill(q, q + m2 * p2, T(0));
+  multiply(a11, lda, b11, ldb, q, p2);
+  accumulate_block(q, p2, m2, p2, c11, ldc);
+  multiply(x, n2, y, p2, q, p2);
+  accumulate_block(q, p2, m2, p2, c12, ldc);
+  accumulate_block(q, p2, m2, p2, c21, ldc);
+  accumulate_block(q, p2, m2, p2, c22, ldc);
+
+  // P3 = (a12 - S2) b22 goes to c12
+  subtract_blocks(a12, lda, x, n2, m2, n2, x, n2);
+  multiply(x, n2, b22, ldb, c12, ldc);
+
+  // P4 = a22 (T2 - b21) is subtracted from c21, negating T4 instead
+  subtract_blocks(b21, ldb, y, p2, n2, p2, y, p2);
+  multiply(a22, lda, y, p2, c21, ldc);
+
+  // P7 = (a11 - a21)(b22 - b12) goes to c21 and c22
+  subtract_blocks(a11, lda, a21, lda, m2, n2, x, n2);
+  subtract_blocks(b22, ldb, b12, ldb, n2, p2, y, p2);
+  std::fill(q, q + m2 * p2, T(0));
+  multiply(x, n2, y, p2, q, p2);
+  accumulate_block(q, p2, m2, p2, c21, ldc);
+  accumulate_block(q, p2, m2, p2, c22, ldc);
+
+  // P2 = a12 b21 goes to c11
+  multiply(a12, lda, b21, ldb, c11, ldc);
+}
+} // namespace
+
+// Strassen-Winograd multiply, c += a * b. While the smallest dimension
+// exceeds Threshold, seven half-size products replace the eight of the
+// classical recursion, which takes over below it with cutoff Leaf. All
+// temporaries come from a single workspace allocated up front.
+template <class T, std::size_t Threshold = tuning<T>::strassen_threshold,
+          std::size_t Leaf = tuning<T>::multiply_leaf>
+void strassen_multiply(const T *a, const T *b, std::size_t m, std::size_t n,
+                       std::size_t p, T *c) {
+  auto work = std::make_unique<T[]>(strassen_workspace<Threshold>(m, n, p));
+  strassen_helper<Threshold, Leaf>(a, b, n, p, p, m, n, p, c, work.get());
+}
+
+// Whether gemm reads an operand as stored or transposed
+enum class matrix_op { none, transpose };
+
+namespace {
+// Operand of gemm, element (i, j) of op(x) is at data[i * row + j * col]
+template <class T> struct gemm_operand {
+  const T *data;
+  std::size_t row;
+  std::size_t col;
+
+  const T *at(std::size_t i, std::size_t j) const {
+    return data + i * row + j * col;
+  }
+};
+
+template <class T>
+gemm_operand<T> make_gemm_operand(matrix_op op, const T *x, std::size_t ldx) {
+  if (op == matrix_op::transpose) {
+    return {x, 1, ldx};
+  }
+  return {x, ldx, 1};
+}
+
+// c = beta * c on an m x p block. A zero beta clears c without reading it.
+template <class T>
+void scale_block(T beta, std::size_t m, std::size_t p, T *c,
+                 std::size_t ldc) {
+  for (std::size_t i = 0; i < m; ++i) {
+    for (std::size_t k = 0; k < p; ++k) {
+      c[i * ldc + k] = beta == T(0) ? T(0) : beta * c[i * ldc + k];
+    }
+  }
+}
+
+// Copies alpha * op(x) on an m x n block into the row-major buffer out
+template <class T>
+void pack_block(gemm_operand<T> x, std::size_t m, std::size_t n, T alpha,
+                T *out) {
+  if (x.col == 1) {
+    for (std::size_t i = 0; i < m; ++i) {
+      std::copy_n(x.at(i, 0), n, out + i * n);
+    }
+  } else {
+    // Stored as an n x m block with row length x.col
+    transpose_block(x.data, n, x.col, n, m, out);
+  }
+  if (alpha != T(1)) {
+    for (std::size_t i = 0; i < m * n; ++i) {
+      out[i] *= alpha;
+    }
+  }
+}
+
+// c = alpha * op(a) * op(b) + beta * c on blocks. beta is applied by the
+// first leaf to reach each block of c, which is the first half of every n
+// split. A transposed or scaled operand is copied into row-major work_a or
+// work_b at the largest block that fits Leaf elements. Below that it is an
+// ordinary operand that every split of the other dimensions reuses.
+template <std::size_t Leaf, class T>
+void gemm_helper(gemm_operand<T> a, gemm_operand<T> b, T alpha, T beta,
+                 std::size_t m, std::size_t n, std::size_t p, T *c,
+                 std::size_t ldc, T *work_a, T *work_b) {
+  if ((a.col != 1 || alpha != T(1)) && m * n <= Leaf) {
+    pack_block(a, m, n, alpha, work_a);
+    a = {work_a, n, 1};
+    alpha = T(1);
+  }
+  if (b.col != 1 && n * p <= Leaf) {
+    pack_block(b, n, p, T(1), work_b);
+    b = {work_b, p, 1};
+  }
+
+  if (m * n * p <= Leaf) {
+    if (beta != T(1)) {
+      scale_block(beta, m, p, c, ldc);
+    }
+    multiply_block(a.data, b.data, a.row, b.row, ldc, m, n, p, c);
+    return;
+  }
+
+  if (m == std::max({m, n, p})) {
+    std::size_t m_half = kernel_half(m, multiply_kernel<T>::mr);
+    gemm_helper<Leaf>(a, b, alpha, beta, m_half, n, p, c, ldc, work_a,
+                      work_b);
+    gemm_helper<Leaf>({a.at(m_half, 0), a.row, a.col}, b, alpha, beta,
+                      m - m_half, n, p, c + m_half * ldc, ldc, work_a, work_b);
+  } else if (n == std::max({m, n, p})) {
+    std::size_t n_half = n / 2;
+    gemm_helper<Leaf>(a, b, alpha, beta, m, n_half, p, c, ldc, work_a,
+                      work_b);
+    gemm_helper<Leaf>({a.at(0, n_half), a.row, a.col},
+                      {b.at(n_half, 0), b.row, b.col}, alpha, T(1), m,
+                      n - n_half, p, c, ldc, work_a, work_b);
+  } else {
+    std::size_t p_half = kernel_half(p, multiply_kernel<T>::nr);
+    gemm_helper<Leaf>(a, b, alpha, beta, m, n, p_half, c, ldc, work_a,
+                      work_b);
+    gemm_helper<Leaf>(a, {b.at(0, p_half), b.row, b.col}, alpha, beta, m, n,
+                      p - p_half, c + p_half, ldc, work_a, work_b);
+  }
+}
+} // namespace
+
+// General matrix multiply, c = alpha * op(a) * op(b) + beta * c, where op(a)
+// is m x n, op(b) is n x p and c is m x p. lda, ldb and ldc are the row
+// lengths of the matrices as stored, so a transposed a is stored n x m.
+// Transposes and scaling happen on the leaves of the recursion, with no
+// extra passes over the operands. As in BLAS, a zero beta ignores the
+// contents of c.
+template <class T, std::size_t Leaf = tuning<T>::multiply_leaf>
+void gemm(matrix_op op_a, matrix_op op_b, std::size_t m, std::size_t n,
+          std::size_t p, T alpha, const T *a, std::size_t lda, const T *b,
+          std::size_t ldb, T beta, T *c, std::size_t ldc) {
+  if (m == 0 || p == 0) {
+    return;
+  }
+  if (n == 0 || alpha == T(0)) {
+    scale_block(beta, m, p, c, ldc);
+    return;
+  }
+  bool pack_a = op_a == matrix_op::transpose || alpha != T(1);
+  bool pack_b = op_b == matrix_op::transpose;
+  std::size_t size_a = pack_a ? std::min(Leaf, m * n) : 0;
+  std::size_t size_b = pack_b ? std::min(Leaf, n * p) : 0;
+  auto work = std::make_unique<T[]>(size_a + size_b);
+  gemm_helper<Leaf>(make_gemm_operand(op_a, a, lda),
+                    make_gemm_operand(op_b, b, ldb), alpha, beta, m, n, p, c,
+                    ldc, work.get(), work.get() + size_a);
+}
+
+namespace {
+// Matrices of at most this many multiply-adds skip the recursion
+constexpr std::size_t multiply_batch_block = 64 * 64 * 64;
+
+// c[k] += a * b[k] for k < p. GCC only honours restrict on parameters, and
+// at -O2 only vectorises loops with a known trip count, hence the chunks.
+template <class T>
+void scaled_row_add(T *__restrict c, const T *__restrict b, T a,
+                    std::size_t p) {
+  constexpr std::size_t width = 8;
+  std::size_t k = 0;
+  for (; k + width <= p; k += width) {
+    for (std::size_t l = 0; l < width; ++l) {
+      c[k + l] += a * b[k + l];
+    }
+  }
+  for (; k < p; ++k) {
+    c[k] += a * b[k];
+  }
+}
+
+template <class T>
+void batch_multiply_one(const T *a, const T *b, std::size_t m, std::size_t n,
+                        std::size_t p, T *c) {
+  if (m * n * p > multiply_batch_block) {
+    matrix_multiply(a, b, m, n, p, c);
+    return;
+  }
+  // i-j-k order streams the rows of b and c
+  for (std::size_t i = 0; i < m; ++i) {
+    for (std::size_t j = 0; j < n; ++j) {
+      scaled_row_add(c + i * p, b + j * p, a[i * n + j], p);
+    }
+  }
+}
+} // namespace
+
+// Computes c_k += a_k * b_k for batch products of m x n and n x p matrices,
+// where matrix k starts at a + k * stride_a and so on. A stride of 0 for a or
+// b uses the same matrix for the whole batch.
+template <class T>
+void batched_matrix_multiply(const T *a, const T *b, std::size_t m,
+                             std::size_t n, std::size_t p, T *c,
+                             std::size_t batch, std::size_t stride_a,
+                             std::size_t stride_b, std::size_t stride_c) {
+  for (std::size_t k = 0; k < batch; ++k) {
+    batch_multiply_one(a + k * stride_a, b + k * stride_b, m, n, p,
+                       c + k * stride_c);
+  }
+}
+
+template <class T>
+void batched_matrix_multiply(const T *a, const T *b, std::size_t m,
+                             std::size_t n, std::size_t p, T *c,
+                             std::size_t batch) {
+  batched_matrix_multiply(a, b, m, n, p, c, batch, m * n, n * p, m * p);
+}
+
+// Spreads the products of the batch across the threads of the pool
+template <class T>
+void batched_matrix_multiply(const T *a, const T *b, std::size_t m,
+                             std::size_t n, std::size_t p, T *c,
+                             std::size_t batch, std::size_t stride_a,
+                             std::size_t stride_b, std::size_t stride_c,
+                             thread_pool &pool) {
+  std::size_t grain =
+      std::max<std::size_t>(1, (1 << 16) / std::max<std::size_t>(m * n * p, 1));
+  pool.parallel_for(0, batch, grain, [=](std::size_t k) {
+    batch_multiply_one(a + k * stride_a, b + k * stride_b, m, n, p,
+                       c + k * stride_c);
+  });
 }
 
 template <class T>
@@ -90,4 +785,22 @@ void naive_matrix_multiply(const T *a, const T *b, std::size_t m, std::size_t n,
     }
   }
 }
+
+template <class T>
+void naive_gemm(matrix_op op_a, matrix_op op_b, std::size_t m, std::size_t n,
+                std::size_t p, T alpha, const T *a, std::size_t lda,
+                const T *b, std::size_t ldb, T beta, T *c, std::size_t ldc) {
+  auto a_op = make_gemm_operand(op_a, a, lda);
+  auto b_op = make_gemm_operand(op_b, b, ldb);
+  for (std::size_t i = 0; i < m; ++i) {
+    for (std::size_t k = 0; k < p; ++k) {
+      T sum(0);
+      for (std::size_t j = 0; j < n; ++j) {
+        sum += *a_op.at(i, j) * *b_op.at(j, k);
+      }
+      T &out = c[i * ldc + k];
+      out = beta == T(0) ? alpha * sum : alpha * sum + beta * out;
+    }
+  }
+}
 } // namespace ra::cache
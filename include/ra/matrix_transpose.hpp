@@ -1,14 +1,19 @@
 #pragma once
 
 #include <algorithm>
+#include <memory>
 #include <utility>
 
+#include "thread_pool.hpp"
+#include "transpose_kernels.hpp"
+#include "tuning.hpp"
+
 namespace ra::cache {
 namespace {
 template <class T, class F>
 void compute_in_place(F transpose_op, std::size_t m, std::size_t n, T *b) {
  	// Inefficient since we are initializing n * m class type T objects
-	std::unique_ptr<T> c(new T[m * n]);
+	std::unique_ptr<T[]> c(new T[m * n]);
   transpose_op(c.get());
 	// Results are copied element wise instead of swapping pointers
 	// since b may be an array on the stack of the caller.
@@ -23,20 +28,37 @@ void compute_in_place(F transpose_op, std::size_t m, std::size_t n, T *b) {
 	}
   return;
 }
-template <class T>
+
+template <std::size_t Leaf, class T>
 void matrix_transpose_helper(const T *a, std::size_t m_orig, std::size_t n_orig,
                              std::size_t m, std::size_t n, T *b) {
-  if (a == b) {
-    compute_in_place(
-        [a, m, n](T *c) { matrix_transpose_helper(a, m, n, m, n, c); }, m, n,
-        b);
+  if (m * n <= Leaf) {
+    transpose_block(a, m_orig, n_orig, m, n, b);
     return;
   }
 
-  if (m * n <= 64) {
+  if (m >= n) {
+    std::size_t m_half = tile_half<T>(m);
+    matrix_transpose_helper<Leaf>(a, m_orig, n_orig, m_half, n, b);
+    matrix_transpose_helper<Leaf>(a + m_half * n_orig, m_orig, n_orig,
+                                  m - m_half, n, b + m_half);
+  } else {
+    std::size_t n_half = tile_half<T>(n);
+    matrix_transpose_helper<Leaf>(a, m_orig, n_orig, m, n_half, b);
+    matrix_transpose_helper<Leaf>(a + n_half, m_orig, n_orig, m, n - n_half,
+                                  b + m_orig * n_half);
+  }
+}
+
+// Swaps the m x n block at a with the transpose of the n x m block at b.
+// Both blocks live in the same matrix with leading dimension n_orig.
+template <std::size_t Leaf, class T>
+void transpose_swap_helper(T *a, T *b, std::size_t n_orig, std::size_t m,
+                           std::size_t n) {
+  if (m * n <= Leaf) {
     for (std::size_t i = 0; i < m; ++i) {
       for (std::size_t j = 0; j < n; ++j) {
-        b[j * m_orig + i] = a[i * n_orig + j];
+        std::swap(a[i * n_orig + j], b[j * n_orig + i]);
       }
     }
     return;
@@ -44,22 +66,458 @@ void matrix_transpose_helper(const T *a, std::size_t m_orig, std::size_t n_orig,
 
   if (m >= n) {
     std::size_t m_half = m / 2;
-    matrix_transpose_helper(a, m_orig, n_orig, m_half, n, b);
-    matrix_transpose_helper(a + m_half * n_orig, m_orig, n_orig, m - m_half, n,
-                            b + m_half);
+    transpose_swap_helper<Leaf>(a, b, n_orig, m_half, n);
+    transpose_swap_helper<Leaf>(a + m_half * n_orig, b + m_half, n_orig,
+                                m - m_half, n);
   } else {
     std::size_t n_half = n / 2;
-    matrix_transpose_helper(a, m_orig, n_orig, m, n_half, b);
-    matrix_transpose_helper(a + n_half, m_orig, n_orig, m, n - n_half,
-                            b + m_orig * n_half);
+    transpose_swap_helper<Leaf>(a, b, n_orig, m, n_half);
+    transpose_swap_helper<Leaf>(a + n_half, b + n_half * n_orig, n_orig, m,
+                                n - n_half);
   }
 }
-} // namespace
 
+// In-place transpose of the n x n diagonal block at a. The off-diagonal
+// quadrants are exchanged by transpose_swap_helper, the diagonal quadrants
+// are handled recursively. Needs O(log n) stack and no scratch storage.
+template <std::size_t Leaf, class T>
+void square_transpose_in_place(T *a, std::size_t n_orig, std::size_t n) {
+  if (n * n <= Leaf) {
+    for (std::size_t i = 0; i < n; ++i) {
+      for (std::size_t j = i + 1; j < n; ++j) {
+        std::swap(a[i * n_orig + j], a[j * n_orig + i]);
+      }
+    }
+    return;
+  }
+
+  std::size_t n_half = n / 2;
+  square_transpose_in_place<Leaf>(a, n_orig, n_half);
+  square_transpose_in_place<Leaf>(a + n_half * n_orig + n_half, n_orig,
+                                  n - n_half);
+  transpose_swap_helper<Leaf>(a + n_half, a + n_half * n_orig, n_orig, n_half,
+                              n - n_half);
+}
+
+// Transposes an m x n matrix whose elements are contiguous segments of
+// seg_len values by following the cycles of the permutation
+// i * n + j -> j * m + i. A cycle is only rotated from its smallest index,
+// which is found by walking the cycle, so no visited flags are needed.
 template <class T>
+void cycle_transpose_in_place(T *a, std::size_t m, std::size_t n,
+                              std::size_t seg_len) {
+  std::size_t last = m * n - 1;
+  auto next = [m, last](std::size_t k) { return k * m % last; };
+
+  for (std::size_t start = 1; start < last; ++start) {
+    std::size_t k = next(start);
+    while (k > start) {
+      k = next(k);
+    }
+    if (k != start) {
+      continue;
+    }
+    // Rotate by swapping through the leader, the segment parked at start
+    // always belongs at the next position of the cycle.
+    for (k = next(start); k != start; k = next(k)) {
+      std::swap_ranges(a + start * seg_len, a + (start + 1) * seg_len,
+                       a + k * seg_len);
+    }
+  }
+}
+
+template <std::size_t Leaf, class T>
+void matrix_transpose_in_place(T *a, std::size_t m, std::size_t n) {
+  if (m <= 1 || n <= 1) {
+    // Row and column vectors share their memory layout with their transpose
+    return;
+  }
+
+  if (m == n) {
+    square_transpose_in_place<Leaf>(a, n, n);
+  } else if (m % n == 0) {
+    // Tall matrix of k stacked n x n blocks. Transpose the blocks, then
+    // interleave their rows by permuting rows of length n as a k x n matrix.
+    std::size_t k = m / n;
+    for (std::size_t i = 0; i < k; ++i) {
+      square_transpose_in_place<Leaf>(a + i * n * n, n, n);
+    }
+    cycle_transpose_in_place(a, k, n, n);
+  } else if (n % m == 0) {
+    // Wide matrix of k adjacent m x m blocks. The inverse of the above:
+    // gather each block into contiguous storage, then transpose it.
+    std::size_t k = n / m;
+    cycle_transpose_in_place(a, m, k, m);
+    for (std::size_t i = 0; i < k; ++i) {
+      square_transpose_in_place<Leaf>(a + i * m * m, m, m);
+    }
+  } else {
+    cycle_transpose_in_place(a, m, n, 1);
+  }
+}
+
+// The transform variants below write op(x, i, j) in place of each element x
+// found at row i and column j of the source matrix, while the element is in
+// cache for the transpose anyway. Offsets give the position of the block
+// within the whole matrix.
+template <std::size_t Leaf, class T, class Op>
+void transform_transpose_helper(const T *a, std::size_t m_orig,
+                                std::size_t n_orig, std::size_t m,
+                                std::size_t n, T *b, const Op &op,
+                                std::size_t row, std::size_t col) {
+  if (m * n <= Leaf) {
+    for (std::size_t i = 0; i < m; ++i) {
+      for (std::size_t j = 0; j < n; ++j) {
+        b[j * m_orig + i] = op(a[i * n_orig + j], row + i, col + j);
+      }
+    }
+    return;
+  }
+
+  if (m >= n) {
+    std::size_t m_half = tile_half<T>(m);
+    transform_transpose_helper<Leaf>(a, m_orig, n_orig, m_half, n, b, op, row,
+                                     col);
+    transform_transpose_helper<Leaf>(a + m_half * n_orig, m_orig, n_orig,
+                                     m - m_half, n, b + m_half, op,
+                                     row + m_half, col);
+  } else {
+    std::size_t n_half = tile_half<T>(n);
+    transform_transpose_helper<Leaf>(a, m_orig, n_orig, m, n_half, b, op, row,
+                                     col);
+    transform_transpose_helper<Leaf>(a + n_half, m_orig, n_orig, m,
+                                     n - n_half, b + m_orig * n_half, op, row,
+                                     col + n_half);
+  }
+}
+
+// transpose_swap_helper with the m x n block at a starting at row a_row and
+// column a_col, and the n x m block at b at b_row and b_col.
+template <std::size_t Leaf, class T, class Op>
+void transform_swap_helper(T *a, T *b, std::size_t n_orig, std::size_t m,
+                           std::size_t n, const Op &op, std::size_t a_row,
+                           std::size_t a_col, std::size_t b_row,
+                           std::size_t b_col) {
+  if (m * n <= Leaf) {
+    for (std::size_t i = 0; i < m; ++i) {
+      for (std::size_t j = 0; j < n; ++j) {
+        T x = a[i * n_orig + j];
+        a[i * n_orig + j] = op(b[j * n_orig + i], b_row + j, b_col + i);
+        b[j * n_orig + i] = op(x, a_row + i, a_col + j);
+      }
+    }
+    return;
+  }
+
+  if (m >= n) {
+    std::size_t m_half = tile_half<T>(m);
+    transform_swap_helper<Leaf>(a, b, n_orig, m_half, n, op, a_row, a_col,
+                                b_row, b_col);
+    transform_swap_helper<Leaf>(a + m_half * n_orig, b + m_half, n_orig,
+                                m - m_half, n, op, a_row + m_half, a_col,
+                                b_row, b_col + m_half);
+  } else {
+    std::size_t n_half = tile_half<T>(n);
+    transform_swap_helper<Leaf>(a, b, n_orig, m, n_half, op, a_row, a_col,
+                                b_row, b_col);
+    transform_swap_helper<Leaf>(a + n_half, b + n_half * n_orig, n_orig, m,
+                                n - n_half, op, a_row, a_col + n_half,
+                                b_row + n_half, b_col);
+  }
+}
+
+// square_transpose_in_place for the n x n block at a starting at row and col
+template <std::size_t Leaf, class T, class Op>
+void square_transform_in_place(T *a, std::size_t n_orig, std::size_t n,
+                               const Op &op, std::size_t row,
+                               std::size_t col) {
+  if (n * n <= Leaf) {
+    for (std::size_t i = 0; i < n; ++i) {
+      a[i * n_orig + i] = op(a[i * n_orig + i], row + i, col + i);
+      for (std::size_t j = i + 1; j < n; ++j) {
+        T x = a[i * n_orig + j];
+        a[i * n_orig + j] = op(a[j * n_orig + i], row + j, col + i);
+        a[j * n_orig + i] = op(x, row + i, col + j);
+      }
+    }
+    return;
+  }
+
+  std::size_t n_half = tile_half<T>(n);
+  square_transform_in_place<Leaf>(a, n_orig, n_half, op, row, col);
+  square_transform_in_place<Leaf>(a + n_half * n_orig + n_half, n_orig,
+                                  n - n_half, op, row + n_half, col + n_half);
+  transform_swap_helper<Leaf>(a + n_half, a + n_half * n_orig, n_orig, n_half,
+                              n - n_half, op, row, col + n_half, row + n_half,
+                              col);
+}
+
+// matrix_transpose_in_place with op applied during the square transposes.
+// Shapes without square blocks are permuted by cycles first and transformed
+// in a separate pass.
+template <std::size_t Leaf, class T, class Op>
+void transform_transpose_in_place(T *a, std::size_t m, std::size_t n,
+                                  const Op &op) {
+  if (m <= 1 || n <= 1) {
+    // Vectors share their memory layout with their transpose, so only op
+    // is applied
+    for (std::size_t i = 0; i < m; ++i) {
+      for (std::size_t j = 0; j < n; ++j) {
+        a[i * n + j] = op(a[i * n + j], i, j);
+      }
+    }
+    return;
+  }
+
+  if (m == n) {
+    square_transform_in_place<Leaf>(a, n, n, op, 0, 0);
+  } else if (m % n == 0) {
+    std::size_t k = m / n;
+    for (std::size_t i = 0; i < k; ++i) {
+      square_transform_in_place<Leaf>(a + i * n * n, n, n, op, i * n, 0);
+    }
+    cycle_transpose_in_place(a, k, n, n);
+  } else if (n % m == 0) {
+    std::size_t k = n / m;
+    cycle_transpose_in_place(a, m, k, m);
+    for (std::size_t i = 0; i < k; ++i) {
+      square_transform_in_place<Leaf>(a + i * m * m, m, m, op, 0, i * m);
+    }
+  } else {
+    // No block structure to fuse with, so op runs as a separate pass in
+    // the order of a
+    for (std::size_t i = 0; i < m; ++i) {
+      for (std::size_t j = 0; j < n; ++j) {
+        a[i * n + j] = op(a[i * n + j], i, j);
+      }
+    }
+    cycle_transpose_in_place(a, m, n, 1);
+  }
+}
+
+// The parallel variants below fork both halves of the recursion onto the
+// pool and hand subproblems of at most grain elements to the sequential code.
+template <std::size_t Leaf, class T>
+void parallel_transpose_helper(thread_pool &pool, std::size_t grain,
+                               const T *a, std::size_t m_orig,
+                               std::size_t n_orig, std::size_t m,
+                               std::size_t n, T *b) {
+  if (m * n <= grain) {
+    matrix_transpose_helper<Leaf>(a, m_orig, n_orig, m, n, b);
+    return;
+  }
+
+  if (m >= n) {
+    std::size_t m_half = tile_half<T>(m);
+    pool.fork_join(
+        [&] {
+          parallel_transpose_helper<Leaf>(pool, grain, a, m_orig, n_orig,
+                                          m_half, n, b);
+        },
+        [&] {
+          parallel_transpose_helper<Leaf>(pool, grain, a + m_half * n_orig,
+                                          m_orig, n_orig, m - m_half, n,
+                                          b + m_half);
+        });
+  } else {
+    std::size_t n_half = tile_half<T>(n);
+    pool.fork_join(
+        [&] {
+          parallel_transpose_helper<Leaf>(pool, grain, a, m_orig, n_orig, m,
+                                          n_half, b);
+        },
+        [&] {
+          parallel_transpose_helper<Leaf>(pool, grain, a + n_half, m_orig,
+                                          n_orig, m, n - n_half,
+                                          b + m_orig * n_half);
+        });
+  }
+}
+
+template <std::size_t Leaf, class T>
+void parallel_transpose_swap_helper(thread_pool &pool, std::size_t grain, T *a,
+                                    T *b, std::size_t n_orig, std::size_t m,
+                                    std::size_t n) {
+  if (m * n <= grain) {
+    transpose_swap_helper<Leaf>(a, b, n_orig, m, n);
+    return;
+  }
+
+  if (m >= n) {
+    std::size_t m_half = m / 2;
+    pool.fork_join(
+        [&] {
+          parallel_transpose_swap_helper<Leaf>(pool, grain, a, b, n_orig,
+                                               m_half, n);
+        },
+        [&] {
+          parallel_transpose_swap_helper<Leaf>(pool, grain, a + m_half * n_orig,
+                                               b + m_half, n_orig, m - m_half,
+                                               n);
+        });
+  } else {
+    std::size_t n_half = n / 2;
+    pool.fork_join(
+        [&] {
+          parallel_transpose_swap_helper<Leaf>(pool, grain, a, b, n_orig, m,
+                                               n_half);
+        },
+        [&] {
+          parallel_transpose_swap_helper<Leaf>(pool, grain, a + n_half,
+                                               b + n_half * n_orig, n_orig, m,
+                                               n - n_half);
+        });
+  }
+}
+
+template <std::size_t Leaf, class T>
+void parallel_square_transpose_in_place(thread_pool &pool, std::size_t grain,
+                                        T *a, std::size_t n_orig,
+                                        std::size_t n) {
+  if (n * n <= grain) {
+    square_transpose_in_place<Leaf>(a, n_orig, n);
+    return;
+  }
+
+  std::size_t n_half = n / 2;
+  T *diag = a + n_half * n_orig + n_half;
+  pool.fork_join(
+      [&] {
+        pool.fork_join(
+            [&] {
+              parallel_square_transpose_in_place<Leaf>(pool, grain, a, n_orig,
+                                                       n_half);
+            },
+            [&] {
+              parallel_square_transpose_in_place<Leaf>(pool, grain, diag,
+                                                       n_orig, n - n_half);
+            });
+      },
+      [&] {
+        parallel_transpose_swap_helper<Leaf>(pool, grain, a + n_half,
+                                             a + n_half * n_orig, n_orig,
+                                             n_half, n - n_half);
+      });
+}
+
+// Only the square transposes run in parallel, the row permutation of the
+// rectangular cases stays sequential.
+template <std::size_t Leaf, class T>
+void parallel_transpose_in_place(thread_pool &pool, std::size_t grain, T *a,
+                                 std::size_t m, std::size_t n) {
+  if (m <= 1 || n <= 1) {
+    return;
+  }
+
+  if (m == n) {
+    parallel_square_transpose_in_place<Leaf>(pool, grain, a, n, n);
+  } else if (m % n == 0) {
+    std::size_t k = m / n;
+    for (std::size_t i = 0; i < k; ++i) {
+      parallel_square_transpose_in_place<Leaf>(pool, grain, a + i * n * n, n,
+                                               n);
+    }
+    cycle_transpose_in_place(a, k, n, n);
+  } else if (n % m == 0) {
+    std::size_t k = n / m;
+    cycle_transpose_in_place(a, m, k, m);
+    for (std::size_t i = 0; i < k; ++i) {
+      parallel_square_transpose_in_place<Leaf>(pool, grain, a + i * m * m, m,
+                                               m);
+    }
+  } else {
+    cycle_transpose_in_place(a, m, n, 1);
+  }
+}
+} // namespace
+
+// Leaf bounds the number of elements m * n handled by a base case.
+template <class T, std::size_t Leaf = tuning<T>::transpose_leaf>
 void matrix_transpose(const T *a, std::size_t m, std::size_t n, T *b) {
+  if (a == b) {
+    matrix_transpose_in_place<Leaf>(b, m, n);
+    return;
+  }
   // Need to propagate dimensions of outermost matrix
-  matrix_transpose_helper(a, m, n, m, n, b);
+  matrix_transpose_helper<Leaf>(a, m, n, m, n, b);
+};
+
+// Transposes like matrix_transpose, writing op(x, i, j) to b for each
+// element x at row i and column j of a, in place if a == b. Fusing an
+// elementwise operation into the transpose saves a separate pass over the
+// matrix, except in place when neither of m and n divides the other. Such
+// shapes are permuted by cycles, and op is applied in a pass of its own.
+template <class T, std::size_t Leaf = tuning<T>::transpose_leaf, class Op>
+void transform_transpose(const T *a, std::size_t m, std::size_t n, T *b,
+                         const Op &op) {
+  if (a == b) {
+    transform_transpose_in_place<Leaf>(b, m, n, op);
+    return;
+  }
+  transform_transpose_helper<Leaf>(a, m, n, m, n, b, op, 0, 0);
+}
+
+// Parallel transpose on a work-stealing pool. Subproblems of at most grain
+// elements are not split across threads any further.
+template <class T, std::size_t Leaf = tuning<T>::transpose_leaf>
+void matrix_transpose(const T *a, std::size_t m, std::size_t n, T *b,
+                      thread_pool &pool, std::size_t grain = 1 << 14) {
+  if (a == b) {
+    parallel_transpose_in_place<Leaf>(pool, grain, b, m, n);
+    return;
+  }
+  parallel_transpose_helper<Leaf>(pool, grain, a, m, n, m, n, b);
+};
+
+template <class T, std::size_t Leaf = tuning<T>::transpose_leaf>
+void matrix_transpose(const T *a, std::size_t m, std::size_t n, T *b,
+                      std::size_t threads) {
+  thread_pool pool(threads);
+  matrix_transpose<T, Leaf>(a, m, n, b, pool);
+};
+
+namespace {
+// Matrices of at most this many elements are transposed as a single block
+constexpr std::size_t transpose_batch_block = 64 * 64;
+
+template <class T>
+void batch_transpose_one(const T *a, std::size_t m, std::size_t n, T *b) {
+  if (a != b && m * n <= transpose_batch_block) {
+    transpose_block(a, m, n, m, n, b);
+  } else {
+    matrix_transpose(a, m, n, b);
+  }
+}
+} // namespace
+
+// Transposes batch m x n matrices. Matrix k is read from a + k * stride_a and
+// written to b + k * stride_b. Small matrices skip the recursion and go
+// straight to the register tiles.
+template <class T>
+void batched_matrix_transpose(const T *a, std::size_t m, std::size_t n, T *b,
+                              std::size_t batch, std::size_t stride_a,
+                              std::size_t stride_b) {
+  for (std::size_t k = 0; k < batch; ++k) {
+    batch_transpose_one(a + k * stride_a, m, n, b + k * stride_b);
+  }
+};
+
+template <class T>
+void batched_matrix_transpose(const T *a, std::size_t m, std::size_t n, T *b,
+                              std::size_t batch) {
+  batched_matrix_transpose(a, m, n, b, batch, m * n, m * n);
+};
+
+// Spreads the matrices of the batch across the threads of the pool
+template <class T>
+void batched_matrix_transpose(const T *a, std::size_t m, std::size_t n, T *b,
+                              std::size_t batch, std::size_t stride_a,
+                              std::size_t stride_b, thread_pool &pool) {
+  std::size_t grain =
+      std::max<std::size_t>(1, (1 << 14) / std::max<std::size_t>(m * n, 1));
+  pool.parallel_for(0, batch, grain, [=](std::size_t k) {
+    batch_transpose_one(a + k * stride_a, m, n, b + k * stride_b);
+  });
 };
 
 template <class T>
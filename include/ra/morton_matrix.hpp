@@ -0,0 +1,245 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+
+#include "matrix_multiply.hpp"
+#include "matrix_transpose.hpp"
+#include "multiply_kernels.hpp"
+
+namespace ra::cache {
+
+// Side length of a Morton tile. Where T has a multiply kernel, tiles are
+// whole multiples of its register block so that no leaf has ragged edges.
+template <class T> constexpr std::size_t morton_tile() {
+  using kernel = multiply_kernel<T>;
+  if constexpr (kernel::mr > 0) {
+    std::size_t tile = std::lcm(kernel::mr, kernel::nr);
+    while (tile < 32) {
+      tile *= 2;
+    }
+    return tile;
+  } else {
+    return 32;
+  }
+}
+
+// Matrix stored as Tile x Tile row-major tiles laid out in Z order: the
+// grid of tiles is split into quadrants recursively, each quadrant stored
+// contiguously, down to single tiles. Quadrants of an odd grid take the
+// extra row or column first, and a grid one tile wide or high is split
+// along its length only, so there is no padding beyond the last partial
+// tiles. Padding elements are zero and stay zero under the kernels below.
+template <class T, std::size_t Tile = morton_tile<T>()> class morton_matrix {
+public:
+  static constexpr std::size_t tile = Tile;
+
+  // Zero m x n matrix
+  morton_matrix(std::size_t m, std::size_t n)
+      : m_(m), n_(n), tile_rows_((m + Tile - 1) / Tile),
+        tile_cols_((n + Tile - 1) / Tile),
+        data_(std::make_unique<T[]>(tile_rows_ * tile_cols_ * Tile * Tile)) {
+  }
+
+  // Converts the row-major m x n matrix at a
+  morton_matrix(const T *a, std::size_t m, std::size_t n)
+      : morton_matrix(m, n) {
+    from_row_major(a);
+  }
+
+  std::size_t rows() const { return m_; }
+  std::size_t cols() const { return n_; }
+  std::size_t tile_rows() const { return tile_rows_; }
+  std::size_t tile_cols() const { return tile_cols_; }
+
+  // Overwrites the matrix with the row-major matrix at a of the same size
+  void from_row_major(const T *a) {
+    visit_tiles(data_.get(), [&](std::size_t ti, std::size_t tj, T *t) {
+      std::size_t m = std::min(Tile, m_ - ti * Tile);
+      std::size_t n = std::min(Tile, n_ - tj * Tile);
+      const T *row = a + ti * Tile * n_ + tj * Tile;
+      for (std::size_t i = 0; i < m; ++i) {
+        std::copy_n(row + i * n_, n, t + i * Tile);
+      }
+    });
+  }
+
+  // Writes the matrix to a in row-major order
+  void to_row_major(T *a) const {
+    const T *data = data_.get();
+    visit_tiles(data, [&](std::size_t ti, std::size_t tj, const T *t) {
+      std::size_t m = std::min(Tile, m_ - ti * Tile);
+      std::size_t n = std::min(Tile, n_ - tj * Tile);
+      T *row = a + ti * Tile * n_ + tj * Tile;
+      for (std::size_t i = 0; i < m; ++i) {
+        std::copy_n(t + i * Tile, n, row + i * n_);
+      }
+    });
+  }
+
+  // Tile at tile row ti and tile column tj, row-major with row length Tile
+  T *tile_data(std::size_t ti, std::size_t tj) {
+    return data_.get() + tile_offset(ti, tj) * Tile * Tile;
+  }
+  const T *tile_data(std::size_t ti, std::size_t tj) const {
+    return data_.get() + tile_offset(ti, tj) * Tile * Tile;
+  }
+
+  T &operator()(std::size_t i, std::size_t j) {
+    return tile_data(i / Tile, j / Tile)[i % Tile * Tile + j % Tile];
+  }
+  const T &operator()(std::size_t i, std::size_t j) const {
+    return tile_data(i / Tile, j / Tile)[i % Tile * Tile + j % Tile];
+  }
+
+private:
+  // Index of a tile in storage order, following the quadrant recursion
+  std::size_t tile_offset(std::size_t ti, std::size_t tj) const {
+    std::size_t rows = tile_rows_;
+    std::size_t cols = tile_cols_;
+    std::size_t offset = 0;
+    while (rows > 1 || cols > 1) {
+      std::size_t rows_half = (rows + 1) / 2;
+      std::size_t cols_half = (cols + 1) / 2;
+      if (ti >= rows_half) {
+        offset += rows_half * cols;
+        ti -= rows_half;
+        rows -= rows_half;
+      } else {
+        rows = rows_half;
+      }
+      if (tj >= cols_half) {
+        offset += rows * cols_half;
+        tj -= cols_half;
+        cols -= cols_half;
+      } else {
+        cols = cols_half;
+      }
+    }
+    return offset;
+  }
+
+  // Calls f(ti, tj, tile) for every tile in storage order, starting at next
+  template <class P, class F> void visit_tiles(P *next, F f) const {
+    if (tile_rows_ > 0 && tile_cols_ > 0) {
+      visit_tiles(0, tile_rows_, 0, tile_cols_, next, f);
+    }
+  }
+
+  template <class P, class F>
+  void visit_tiles(std::size_t ti, std::size_t rows, std::size_t tj,
+                   std::size_t cols, P *&next, F &f) const {
+    if (rows == 1 && cols == 1) {
+      f(ti, tj, next);
+      next += Tile * Tile;
+      return;
+    }
+    std::size_t rows_half = (rows + 1) / 2;
+    std::size_t cols_half = (cols + 1) / 2;
+    visit_tiles(ti, rows_half, tj, cols_half, next, f);
+    if (cols > cols_half) {
+      visit_tiles(ti, rows_half, tj + cols_half, cols - cols_half, next, f);
+    }
+    if (rows > rows_half) {
+      visit_tiles(ti + rows_half, rows - rows_half, tj, cols_half, next, f);
+      if (cols > cols_half) {
+        visit_tiles(ti + rows_half, rows - rows_half, tj + cols_half,
+                    cols - cols_half, next, f);
+      }
+    }
+  }
+
+  std::size_t m_;
+  std::size_t n_;
+  std::size_t tile_rows_;
+  std::size_t tile_cols_;
+  std::unique_ptr<T[]> data_;
+};
+
+namespace {
+// Multiplies the m x n tiles of a at (i, j) with the n x p tiles of b at
+// (j, k) into c, halving tile ranges the way the layout does so that each
+// half is a run of contiguous quadrants.
+template <class T, std::size_t Tile>
+void morton_multiply_helper(const morton_matrix<T, Tile> &a,
+                            const morton_matrix<T, Tile> &b,
+                            morton_matrix<T, Tile> &c, std::size_t i,
+                            std::size_t m, std::size_t j, std::size_t n,
+                            std::size_t k, std::size_t p) {
+  if (m == 1 && n == 1 && p == 1) {
+    multiply_block(a.tile_data(i, j), b.tile_data(j, k), Tile, Tile, Tile,
+                   Tile, Tile, Tile, c.tile_data(i, k));
+    return;
+  }
+
+  if (m == std::max({m, n, p})) {
+    std::size_t m_half = (m + 1) / 2;
+    morton_multiply_helper(a, b, c, i, m_half, j, n, k, p);
+    morton_multiply_helper(a, b, c, i + m_half, m - m_half, j, n, k, p);
+  } else if (n == std::max({m, n, p})) {
+    std::size_t n_half = (n + 1) / 2;
+    morton_multiply_helper(a, b, c, i, m, j, n_half, k, p);
+    morton_multiply_helper(a, b, c, i, m, j + n_half, n - n_half, k, p);
+  } else {
+    std::size_t p_half = (p + 1) / 2;
+    morton_multiply_helper(a, b, c, i, m, j, n, k, p_half);
+    morton_multiply_helper(a, b, c, i, m, j, n, k + p_half, p - p_half);
+  }
+}
+
+template <class T, std::size_t Tile>
+void morton_transpose_helper(const morton_matrix<T, Tile> &a,
+                             morton_matrix<T, Tile> &b, std::size_t i,
+                             std::size_t m, std::size_t j, std::size_t n) {
+  if (m == 1 && n == 1) {
+    transpose_block(a.tile_data(i, j), Tile, Tile, Tile, Tile,
+                    b.tile_data(j, i));
+    return;
+  }
+
+  if (m >= n) {
+    std::size_t m_half = (m + 1) / 2;
+    morton_transpose_helper(a, b, i, m_half, j, n);
+    morton_transpose_helper(a, b, i + m_half, m - m_half, j, n);
+  } else {
+    std::size_t n_half = (n + 1) / 2;
+    morton_transpose_helper(a, b, i, m, j, n_half);
+    morton_transpose_helper(a, b, i, m, j + n_half, n - n_half);
+  }
+}
+} // namespace
+
+// c += a * b on Morton matrices. Leaves are whole tiles, contiguous in
+// memory, multiplied by the register kernel with row length Tile. Throws
+// std::invalid_argument if the dimensions do not match.
+template <class T, std::size_t Tile>
+void matrix_multiply(const morton_matrix<T, Tile> &a,
+                     const morton_matrix<T, Tile> &b,
+                     morton_matrix<T, Tile> &c) {
+  if (a.cols() != b.rows() || c.rows() != a.rows() || c.cols() != b.cols()) {
+    throw std::invalid_argument("Matrix dimensions do not match");
+  }
+  if (a.tile_rows() == 0 || a.tile_cols() == 0 || b.tile_cols() == 0) {
+    return;
+  }
+  morton_multiply_helper(a, b, c, 0, a.tile_rows(), 0, a.tile_cols(), 0,
+                         b.tile_cols());
+}
+
+// Writes the transpose of a to b, which must be a.cols() x a.rows(). Throws
+// std::invalid_argument otherwise.
+template <class T, std::size_t Tile>
+void matrix_transpose(const morton_matrix<T, Tile> &a,
+                      morton_matrix<T, Tile> &b) {
+  if (b.rows() != a.cols() || b.cols() != a.rows()) {
+    throw std::invalid_argument("Matrix dimensions do not match");
+  }
+  if (a.tile_rows() == 0 || a.tile_cols() == 0) {
+    return;
+  }
+  morton_transpose_helper(a, b, 0, a.tile_rows(), 0, a.tile_cols());
+}
+} // namespace ra::cache
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace ra::cache {
+
+// Vector operations used by the multiply kernel for inputs of type T
+// accumulated into U. lanes is the number of elements held by one register;
+// load widens them if the arithmetic happens in a wider type. The primary
+// template has no vector support (lanes == 0), in which case callers fall
+// back to the scalar loop.
+template <class T, class U = T> struct multiply_ops {
+  static constexpr std::size_t lanes = 0;
+};
+
+#if defined(__AVX2__) && defined(__FMA__)
+template <> struct multiply_ops<float> {
+  using reg = __m256;
+  static constexpr std::size_t lanes = 8;
+  static reg zero() { return _mm256_setzero_ps(); }
+  static reg load(const float *p) { return _mm256_loadu_ps(p); }
+  static reg broadcast(float x) { return _mm256_set1_ps(x); }
+  static reg madd(reg acc, reg a, reg b) { return _mm256_fmadd_ps(a, b, acc); }
+  static void accumulate(float *p, reg acc) {
+    _mm256_storeu_ps(p, _mm256_add_ps(_mm256_loadu_ps(p), acc));
+  }
+};
+
+template <> struct multiply_ops<double> {
+  using reg = __m256d;
+  static constexpr std::size_t lanes = 4;
+  static reg zero() { return _mm256_setzero_pd(); }
+  static reg load(const double *p) { return _mm256_loadu_pd(p); }
+  static reg broadcast(double x) { return _mm256_set1_pd(x); }
+  static reg madd(reg acc, reg a, reg b) { return _mm256_fmadd_pd(a, b, acc); }
+  static void accumulate(double *p, reg acc) {
+    _mm256_storeu_pd(p, _mm256_add_pd(_mm256_loadu_pd(p), acc));
+  }
+};
+#endif
+
+#if defined(__AVX2__)
+template <> struct multiply_ops<std::int32_t> {
+  using reg = __m256i;
+  static constexpr std::size_t lanes = 8;
+  static reg zero() { return _mm256_setzero_si256(); }
+  static reg load(const std::int32_t *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  }
+  static reg broadcast(std::int32_t x) { return _mm256_set1_epi32(x); }
+  static reg madd(reg acc, reg a, reg b) {
+    return _mm256_add_epi32(acc, _mm256_mullo_epi32(a, b));
+  }
+  static void accumulate(std::int32_t *p, reg acc) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p),
+                        _mm256_add_epi32(load(p), acc));
+  }
+};
+
+template <> struct multiply_ops<std::int16_t> {
+  using reg = __m256i;
+  static constexpr std::size_t lanes = 16;
+  static reg zero() { return _mm256_setzero_si256(); }
+  static reg load(const std::int16_t *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  }
+  static reg broadcast(std::int16_t x) { return _mm256_set1_epi16(x); }
+  static reg madd(reg acc, reg a, reg b) {
+    return _mm256_add_epi16(acc, _mm256_mullo_epi16(a, b));
+  }
+  static void accumulate(std::int16_t *p, reg acc) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p),
+                        _mm256_add_epi16(load(p), acc));
+  }
+};
+
+// AVX2 has no 8 bit multiply. Products are formed in 16 bit lanes and
+// truncated on the way out, which wraps exactly like 8 bit arithmetic.
+template <> struct multiply_ops<std::int8_t> {
+  using reg = __m256i;
+  static constexpr std::size_t lanes = 16;
+  static reg zero() { return _mm256_setzero_si256(); }
+  static reg load(const std::int8_t *p) {
+    return _mm256_cvtepi8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+  }
+  static reg broadcast(std::int8_t x) { return _mm256_set1_epi16(x); }
+  static reg madd(reg acc, reg a, reg b) {
+    return _mm256_add_epi16(acc, _mm256_mullo_epi16(a, b));
+  }
+  static void accumulate(std::int8_t *p, reg acc) {
+    __m256i sum = _mm256_and_si256(_mm256_add_epi16(load(p), acc),
+                                   _mm256_set1_epi16(0xFF));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p),
+                     _mm_packus_epi16(_mm256_castsi256_si128(sum),
+                                      _mm256_extracti128_si256(sum, 1)));
+  }
+};
+
+// 16 bit inputs accumulated in 64 bits. vpmuldq multiplies the low 32 bits
+// of each 64 bit lane, which hold the sign-extended inputs.
+template <> struct multiply_ops<std::int16_t, std::int64_t> {
+  using reg = __m256i;
+  static constexpr std::size_t lanes = 4;
+  static reg zero() { return _mm256_setzero_si256(); }
+  static reg load(const std::int16_t *p) {
+    return _mm256_cvtepi16_epi64(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+  }
+  static reg broadcast(std::int16_t x) { return _mm256_set1_epi64x(x); }
+  static reg madd(reg acc, reg a, reg b) {
+    return _mm256_add_epi64(acc, _mm256_mul_epi32(a, b));
+  }
+  static void accumulate(std::int64_t *p, reg acc) {
+    __m256i *q = reinterpret_cast<__m256i *>(p);
+    _mm256_storeu_si256(q, _mm256_add_epi64(_mm256_loadu_si256(q), acc));
+  }
+};
+#endif
+
+// Computes the mr x nr block c += a * b over an inner dimension of n,
+// keeping the whole block of c in registers. nr spans two registers, so the
+// 12 accumulators, two rows of b and a broadcast fit the 16 AVX registers.
+template <class T, class U = T,
+          std::size_t Lanes = multiply_ops<T, U>::lanes>
+struct multiply_kernel {
+  using ops = multiply_ops<T, U>;
+  static constexpr std::size_t mr = 6;
+  static constexpr std::size_t nr = 2 * Lanes;
+
+  static void run(std::size_t n, const T *a, std::size_t lda, const T *b,
+                  std::size_t ldb, U *c, std::size_t ldc) {
+    typename ops::reg acc[mr][2];
+    for (std::size_t i = 0; i < mr; ++i) {
+      acc[i][0] = ops::zero();
+      acc[i][1] = ops::zero();
+    }
+    for (std::size_t j = 0; j < n; ++j) {
+      auto b0 = ops::load(b + j * ldb);
+      auto b1 = ops::load(b + j * ldb + Lanes);
+      for (std::size_t i = 0; i < mr; ++i) {
+        auto a_ij = ops::broadcast(a[i * lda + j]);
+        acc[i][0] = ops::madd(acc[i][0], a_ij, b0);
+        acc[i][1] = ops::madd(acc[i][1], a_ij, b1);
+      }
+    }
+    for (std::size_t i = 0; i < mr; ++i) {
+      ops::accumulate(c + i * ldc, acc[i][0]);
+      ops::accumulate(c + i * ldc + Lanes, acc[i][1]);
+    }
+  }
+};
+
+template <class T, class U> struct multiply_kernel<T, U, 0> {
+  static constexpr std::size_t mr = 0;
+  static constexpr std::size_t nr = 0;
+};
+
+#if defined(__AVX2__)
+// 8 and 16 bit inputs accumulated in 32 bits, two steps of the inner
+// dimension at a time. Rows j and j + 1 of b are interleaved so that
+// vpmaddwd, or vpdpwssd with VNNI, adds both products into each 32 bit lane
+// exactly. pmaddubsw would take four 8 bit steps but saturates, and only
+// multiplies unsigned by signed bytes.
+template <class T> struct pair_multiply_kernel {
+  static constexpr std::size_t mr = 6;
+  static constexpr std::size_t nr = 16;
+
+  // 16 elements of b widened to 16 bit lanes
+  static __m256i load(const T *p) {
+    if constexpr (sizeof(T) == 1) {
+      return _mm256_cvtepi8_epi16(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+    } else {
+      return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    }
+  }
+
+  static __m256i madd(__m256i acc, __m256i a, __m256i b) {
+#if defined(__AVX512VNNI__) && defined(__AVX512VL__)
+    return _mm256_dpwssd_epi32(acc, a, b);
+#elif defined(__AVXVNNI__)
+    return _mm256_dpwssd_avx_epi32(acc, a, b);
+#else
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(a, b));
+#endif
+  }
+
+  // Each 32 bit lane holds a0 and a1 as its 16 bit halves
+  static __m256i broadcast(T a0, T a1) {
+    return _mm256_set1_epi32(static_cast<std::uint16_t>(a0) |
+                             static_cast<std::uint32_t>(a1) << 16);
+  }
+
+  static void step(__m256i (&acc)[mr][2], __m256i row0, __m256i row1,
+                   const T *a, std::size_t lda, std::size_t j, bool pair) {
+    // Columns 0-3 and 8-11 land in lo, 4-7 and 12-15 in hi
+    __m256i lo = _mm256_unpacklo_epi16(row0, row1);
+    __m256i hi = _mm256_unpackhi_epi16(row0, row1);
+    for (std::size_t i = 0; i < mr; ++i) {
+      __m256i a_ij = broadcast(a[i * lda + j], pair ? a[i * lda + j + 1] : 0);
+      acc[i][0] = madd(acc[i][0], a_ij, lo);
+      acc[i][1] = madd(acc[i][1], a_ij, hi);
+    }
+  }
+
+  static void run(std::size_t n, const T *a, std::size_t lda, const T *b,
+                  std::size_t ldb, std::int32_t *c, std::size_t ldc) {
+    __m256i acc[mr][2];
+    for (std::size_t i = 0; i < mr; ++i) {
+      acc[i][0] = _mm256_setzero_si256();
+      acc[i][1] = _mm256_setzero_si256();
+    }
+    std::size_t j = 0;
+    for (; j + 2 <= n; j += 2) {
+      step(acc, load(b + j * ldb), load(b + (j + 1) * ldb), a, lda, j, true);
+    }
+    if (j < n) {
+      step(acc, load(b + j * ldb), _mm256_setzero_si256(), a, lda, j, false);
+    }
+    for (std::size_t i = 0; i < mr; ++i) {
+      __m256i *row = reinterpret_cast<__m256i *>(c + i * ldc);
+      __m256i left = _mm256_permute2x128_si256(acc[i][0], acc[i][1], 0x20);
+      __m256i right = _mm256_permute2x128_si256(acc[i][0], acc[i][1], 0x31);
+      _mm256_storeu_si256(row,
+                          _mm256_add_epi32(_mm256_loadu_si256(row), left));
+      _mm256_storeu_si256(
+          row + 1, _mm256_add_epi32(_mm256_loadu_si256(row + 1), right));
+    }
+  }
+};
+
+template <>
+struct multiply_kernel<std::int8_t, std::int32_t>
+    : pair_multiply_kernel<std::int8_t> {};
+
+template <>
+struct multiply_kernel<std::int16_t, std::int32_t>
+    : pair_multiply_kernel<std::int16_t> {};
+#endif
+} // namespace ra::cache
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace ra::cache {
+
+// Fork-join pool with one task deque per thread. A thread pushes and pops
+// its own tasks at the back, idle threads steal the oldest (and therefore
+// largest) tasks from the front of other deques. Threads that are waiting
+// for a join keep executing tasks, so nested forks cannot deadlock.
+//
+// A pool of size n runs n - 1 worker threads; the thread calling into the
+// pool takes part in the computation as the n-th one.
+class thread_pool {
+public:
+  explicit thread_pool(
+      std::size_t threads = std::max(1u, std::thread::hardware_concurrency()))
+      : queues_(std::max<std::size_t>(threads, 1)) {
+    for (std::size_t i = 0; i + 1 < queues_.size(); ++i) {
+      workers_.emplace_back([this, i] { work(i); });
+    }
+  }
+
+  thread_pool(const thread_pool &) = delete;
+  thread_pool &operator=(const thread_pool &) = delete;
+
+  ~thread_pool() {
+    {
+      std::lock_guard<std::mutex> lock(sleep_mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  std::size_t size() const { return queues_.size(); }
+
+  // Runs f and g, potentially in parallel, and returns once both are done.
+  // If either throws, the exception is rethrown after both have finished.
+  template <class F, class G> void fork_join(F &&f, G &&g) {
+    if (workers_.empty()) {
+      f();
+      g();
+      return;
+    }
+
+    task t;
+    t.run = [](void *g) { (*static_cast<std::remove_reference_t<G> *>(g))(); };
+    t.arg = const_cast<void *>(static_cast<const void *>(std::addressof(g)));
+    std::size_t slot = current_slot();
+    push(slot, &t);
+
+    std::exception_ptr error;
+    try {
+      f();
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    if (pop(slot, &t)) {
+      execute(&t);
+    } else {
+      // Stolen, help out until the thief is done
+      while (!t.done.load(std::memory_order_acquire)) {
+        if (task *other = find_task(slot)) {
+          execute(other);
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    }
+
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    if (t.error) {
+      std::rethrow_exception(t.error);
+    }
+  }
+
+  // Calls f(i) for every i in [begin, end), splitting the range in half
+  // until at most grain indices remain.
+  template <class F>
+  void parallel_for(std::size_t begin, std::size_t end, std::size_t grain,
+                    const F &f) {
+    if (end - begin <= std::max<std::size_t>(grain, 1)) {
+      for (std::size_t i = begin; i < end; ++i) {
+        f(i);
+      }
+      return;
+    }
+    std::size_t mid = begin + (end - begin) / 2;
+    fork_join([&] { parallel_for(begin, mid, grain, f); },
+              [&] { parallel_for(mid, end, grain, f); });
+  }
+
+private:
+  struct task {
+    void (*run)(void *) = nullptr;
+    void *arg = nullptr;
+    std::exception_ptr error;
+    std::atomic<bool> done{false};
+  };
+
+  struct queue {
+    std::mutex mutex;
+    std::deque<task *> tasks;
+  };
+
+  // Threads outside the pool share the last deque
+  std::size_t current_slot() const {
+    return current_pool_ == this ? current_index_ : queues_.size() - 1;
+  }
+
+  void push(std::size_t slot, task *t) {
+    {
+      std::lock_guard<std::mutex> lock(queues_[slot].mutex);
+      {
+        // Counted before it can be stolen, so that a thief's decrement
+        // never wraps pending_. Taking the lock orders the increment with
+        // a worker about to sleep.
+        std::lock_guard<std::mutex> sleep_lock(sleep_mutex_);
+        ++pending_;
+      }
+      queues_[slot].tasks.push_back(t);
+    }
+    wake_.notify_one();
+  }
+
+  // Removes t from the back of the deque unless it has been stolen
+  bool pop(std::size_t slot, task *t) {
+    std::lock_guard<std::mutex> lock(queues_[slot].mutex);
+    auto &tasks = queues_[slot].tasks;
+    if (tasks.empty() || tasks.back() != t) {
+      return false;
+    }
+    tasks.pop_back();
+    --pending_;
+    return true;
+  }
+
+  task *find_task(std::size_t slot) {
+    {
+      std::lock_guard<std::mutex> lock(queues_[slot].mutex);
+      auto &tasks = queues_[slot].tasks;
+      if (!tasks.empty()) {
+        task *t = tasks.back();
+        tasks.pop_back();
+        --pending_;
+        return t;
+      }
+    }
+    for (std::size_t i = 1; i < queues_.size(); ++i) {
+      auto &victim = queues_[(slot + i) % queues_.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.tasks.empty()) {
+        task *t = victim.tasks.front();
+        victim.tasks.pop_front();
+        --pending_;
+        return t;
+      }
+    }
+    return nullptr;
+  }
+
+  static void execute(task *t) {
+    try {
+      t->run(t->arg);
+    } catch (...) {
+      t->error = std::current_exception();
+    }
+    t->done.store(true, std::memory_order_release);
+  }
+
+  void work(std::size_t index) {
+    current_pool_ = this;
+    current_index_ = index;
+    while (true) {
+      if (task *t = find_task(index)) {
+        execute(t);
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(sleep_mutex_);
+      wake_.wait(lock, [this] { return stop_ || pending_ > 0; });
+      if (stop_) {
+        return;
+      }
+    }
+  }
+
+  inline static thread_local const thread_pool *current_pool_ = nullptr;
+  inline static thread_local std::size_t current_index_ = 0;
+
+  std::vector<queue> queues_;
+  std::vector<std::thread> workers_;
+  std::atomic<std::size_t> pending_{0};
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_;
+  bool stop_ = false;
+};
+} // namespace ra::cache
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace ra::cache {
+namespace {
+// Register transposes of a tile x tile block of Size byte elements. Strides
+// are given in elements. The primary template has no kernel (tile == 0), in
+// which case callers fall back to the scalar loop.
+template <std::size_t Size> struct transpose_kernel {
+  static constexpr std::size_t tile = 0;
+};
+
+#if defined(__SSE2__)
+template <> struct transpose_kernel<1> {
+  static constexpr std::size_t tile = 8;
+
+  static void run(const void *a, std::size_t lda, void *b, std::size_t ldb) {
+    auto src = static_cast<const char *>(a);
+    auto dst = static_cast<char *>(b);
+    __m128i r[8];
+    for (int i = 0; i < 8; ++i) {
+      r[i] = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i * lda));
+    }
+    __m128i t0 = _mm_unpacklo_epi8(r[0], r[1]);
+    __m128i t1 = _mm_unpacklo_epi8(r[2], r[3]);
+    __m128i t2 = _mm_unpacklo_epi8(r[4], r[5]);
+    __m128i t3 = _mm_unpacklo_epi8(r[6], r[7]);
+    __m128i u0 = _mm_unpacklo_epi16(t0, t1);
+    __m128i u1 = _mm_unpackhi_epi16(t0, t1);
+    __m128i u2 = _mm_unpacklo_epi16(t2, t3);
+    __m128i u3 = _mm_unpackhi_epi16(t2, t3);
+    // Each of these holds two output rows
+    __m128i c[4] = {_mm_unpacklo_epi32(u0, u2), _mm_unpackhi_epi32(u0, u2),
+                    _mm_unpacklo_epi32(u1, u3), _mm_unpackhi_epi32(u1, u3)};
+    for (int j = 0; j < 4; ++j) {
+      _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + 2 * j * ldb), c[j]);
+      _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + (2 * j + 1) * ldb),
+                       _mm_srli_si128(c[j], 8));
+    }
+  }
+};
+
+template <> struct transpose_kernel<2> {
+  static constexpr std::size_t tile = 8;
+
+  static void run(const void *a, std::size_t lda, void *b, std::size_t ldb) {
+    auto src = static_cast<const char *>(a);
+    auto dst = static_cast<char *>(b);
+    __m128i r[8];
+    for (int i = 0; i < 8; ++i) {
+      r[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * i * lda));
+    }
+    __m128i t0 = _mm_unpacklo_epi16(r[0], r[1]);
+    __m128i t1 = _mm_unpackhi_epi16(r[0], r[1]);
+    __m128i t2 = _mm_unpacklo_epi16(r[2], r[3]);
+    __m128i t3 = _mm_unpackhi_epi16(r[2], r[3]);
+    __m128i t4 = _mm_unpacklo_epi16(r[4], r[5]);
+    __m128i t5 = _mm_unpackhi_epi16(r[4], r[5]);
+    __m128i t6 = _mm_unpacklo_epi16(r[6], r[7]);
+    __m128i t7 = _mm_unpackhi_epi16(r[6], r[7]);
+    __m128i u0 = _mm_unpacklo_epi32(t0, t2);
+    __m128i u1 = _mm_unpackhi_epi32(t0, t2);
+    __m128i u2 = _mm_unpacklo_epi32(t1, t3);
+    __m128i u3 = _mm_unpackhi_epi32(t1, t3);
+    __m128i u4 = _mm_unpacklo_epi32(t4, t6);
+    __m128i u5 = _mm_unpackhi_epi32(t4, t6);
+    __m128i u6 = _mm_unpacklo_epi32(t5, t7);
+    __m128i u7 = _mm_unpackhi_epi32(t5, t7);
+    __m128i c[8] = {_mm_unpacklo_epi64(u0, u4), _mm_unpackhi_epi64(u0, u4),
+                    _mm_unpacklo_epi64(u1, u5), _mm_unpackhi_epi64(u1, u5),
+                    _mm_unpacklo_epi64(u2, u6), _mm_unpackhi_epi64(u2, u6),
+                    _mm_unpacklo_epi64(u3, u7), _mm_unpackhi_epi64(u3, u7)};
+    for (int j = 0; j < 8; ++j) {
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 2 * j * ldb), c[j]);
+    }
+  }
+};
+
+#if defined(__AVX2__)
+template <> struct transpose_kernel<4> {
+  static constexpr std::size_t tile = 8;
+
+  static void run(const void *a, std::size_t lda, void *b, std::size_t ldb) {
+    auto src = static_cast<const char *>(a);
+    auto dst = static_cast<char *>(b);
+    __m256i r[8];
+    for (int i = 0; i < 8; ++i) {
+      r[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 4 * i * lda));
+    }
+    // 4x4 transposes within each 128 bit lane, then exchange the lanes
+    __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+    __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+    __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+    __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+    __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+    __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+    __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+    __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+    __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+    __m256i c[8] = {_mm256_permute2x128_si256(u0, u4, 0x20),
+                    _mm256_permute2x128_si256(u1, u5, 0x20),
+                    _mm256_permute2x128_si256(u2, u6, 0x20),
+                    _mm256_permute2x128_si256(u3, u7, 0x20),
+                    _mm256_permute2x128_si256(u0, u4, 0x31),
+                    _mm256_permute2x128_si256(u1, u5, 0x31),
+                    _mm256_permute2x128_si256(u2, u6, 0x31),
+                    _mm256_permute2x128_si256(u3, u7, 0x31)};
+    for (int j = 0; j < 8; ++j) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 4 * j * ldb), c[j]);
+    }
+  }
+};
+
+template <> struct transpose_kernel<8> {
+  static constexpr std::size_t tile = 4;
+
+  static void run(const void *a, std::size_t lda, void *b, std::size_t ldb) {
+    auto src = static_cast<const char *>(a);
+    auto dst = static_cast<char *>(b);
+    __m256i r[4];
+    for (int i = 0; i < 4; ++i) {
+      r[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 8 * i * lda));
+    }
+    __m256i t0 = _mm256_unpacklo_epi64(r[0], r[1]);
+    __m256i t1 = _mm256_unpackhi_epi64(r[0], r[1]);
+    __m256i t2 = _mm256_unpacklo_epi64(r[2], r[3]);
+    __m256i t3 = _mm256_unpackhi_epi64(r[2], r[3]);
+    __m256i c[4] = {_mm256_permute2x128_si256(t0, t2, 0x20),
+                    _mm256_permute2x128_si256(t1, t3, 0x20),
+                    _mm256_permute2x128_si256(t0, t2, 0x31),
+                    _mm256_permute2x128_si256(t1, t3, 0x31)};
+    for (int j = 0; j < 4; ++j) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 8 * j * ldb), c[j]);
+    }
+  }
+};
+// Two 16 byte elements per row fill a register, so rows 0 and 1 of the
+// tile swap their upper and lower halves
+template <> struct transpose_kernel<16> {
+  static constexpr std::size_t tile = 2;
+
+  static void run(const void *a, std::size_t lda, void *b, std::size_t ldb) {
+    auto src = static_cast<const char *>(a);
+    auto dst = static_cast<char *>(b);
+    __m256i r0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+    __m256i r1 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 16 * lda));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst),
+                        _mm256_permute2x128_si256(r0, r1, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 16 * ldb),
+                        _mm256_permute2x128_si256(r0, r1, 0x31));
+  }
+};
+#else
+template <> struct transpose_kernel<4> {
+  static constexpr std::size_t tile = 4;
+
+  static void run(const void *a, std::size_t lda, void *b, std::size_t ldb) {
+    auto src = static_cast<const char *>(a);
+    auto dst = static_cast<char *>(b);
+    __m128i r[4];
+    for (int i = 0; i < 4; ++i) {
+      r[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 4 * i * lda));
+    }
+    __m128i t0 = _mm_unpacklo_epi32(r[0], r[1]);
+    __m128i t1 = _mm_unpacklo_epi32(r[2], r[3]);
+    __m128i t2 = _mm_unpackhi_epi32(r[0], r[1]);
+    __m128i t3 = _mm_unpackhi_epi32(r[2], r[3]);
+    __m128i c[4] = {_mm_unpacklo_epi64(t0, t1), _mm_unpackhi_epi64(t0, t1),
+                    _mm_unpacklo_epi64(t2, t3), _mm_unpackhi_epi64(t2, t3)};
+    for (int j = 0; j < 4; ++j) {
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 4 * j * ldb), c[j]);
+    }
+  }
+};
+
+template <> struct transpose_kernel<8> {
+  static constexpr std::size_t tile = 2;
+
+  static void run(const void *a, std::size_t lda, void *b, std::size_t ldb) {
+    auto src = static_cast<const char *>(a);
+    auto dst = static_cast<char *>(b);
+    __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+    __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 8 * lda));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_unpacklo_epi64(r0, r1));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 8 * ldb),
+                     _mm_unpackhi_epi64(r0, r1));
+  }
+};
+// One 16 byte element per register, the tile is moved without shuffles
+template <> struct transpose_kernel<16> {
+  static constexpr std::size_t tile = 2;
+
+  static void run(const void *a, std::size_t lda, void *b, std::size_t ldb) {
+    auto src = static_cast<const char *>(a);
+    auto dst = static_cast<char *>(b);
+    __m128i r[4];
+    for (int i = 0; i < 2; ++i) {
+      for (int j = 0; j < 2; ++j) {
+        r[2 * i + j] = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(src + 16 * (i * lda + j)));
+      }
+    }
+    for (int j = 0; j < 2; ++j) {
+      for (int i = 0; i < 2; ++i) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 16 * (j * ldb + i)),
+                         r[2 * i + j]);
+      }
+    }
+  }
+};
+#endif
+#endif
+
+// Side length of the register tile used for T, 0 if T has no kernel
+template <class T> constexpr std::size_t transpose_tile() {
+  if constexpr (std::is_trivially_copyable_v<T>) {
+    return transpose_kernel<sizeof(T)>::tile;
+  } else {
+    return 0;
+  }
+}
+
+// Transposes the m x n block at a into b, moving whole tiles through
+// registers and the ragged right and bottom edges element by element.
+template <class T>
+void transpose_block(const T *a, std::size_t m_orig, std::size_t n_orig,
+                     std::size_t m, std::size_t n, T *b) {
+  constexpr std::size_t tile = transpose_tile<T>();
+  std::size_t i = 0;
+  if constexpr (tile > 0) {
+    if (m >= tile && n >= tile) {
+      for (; m - i >= tile; i += tile) {
+        std::size_t j = 0;
+        for (; n - j >= tile; j += tile) {
+          transpose_kernel<sizeof(T)>::run(a + i * n_orig + j, n_orig,
+                                           b + j * m_orig + i, m_orig);
+        }
+        std::size_t cols = n - j;
+        for (std::size_t l = 0; l < cols; ++l) {
+          for (std::size_t k = 0; k < tile; ++k) {
+            b[(j + l) * m_orig + i + k] = a[(i + k) * n_orig + j + l];
+          }
+        }
+      }
+    }
+  }
+  std::size_t rows = m - i;
+  for (std::size_t k = 0; k < rows; ++k) {
+    for (std::size_t j = 0; j < n; ++j) {
+      b[j * m_orig + i + k] = a[(i + k) * n_orig + j];
+    }
+  }
+}
+
+// Splits a dimension in half, rounded down to a multiple of the tile so that
+// leaves are made up of whole tiles wherever the matrix allows it.
+template <class T> std::size_t tile_half(std::size_t m) {
+  constexpr std::size_t tile = transpose_tile<T>();
+  if constexpr (tile > 0) {
+    if (m >= 2 * tile) {
+      return m / 2 / tile * tile;
+    }
+  }
+  return m / 2;
+}
+} // namespace
+} // namespace ra::cache
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+#include "matrix_multiply.hpp"
+#include "tuning.hpp"
+
+namespace ra::cache {
+
+// Whether the triangular matrix multiplies the unknowns from the left,
+// op(a) x = b, or from the right, x op(a) = b
+enum class matrix_side { left, right };
+
+// Which triangle of a holds the matrix, the other one is never read
+enum class matrix_triangle { lower, upper };
+
+// A unit diagonal is implied and not read
+enum class matrix_diagonal { non_unit, unit };
+
+namespace {
+// Triangular operand of a solve. Element (i, j) of op(a) and the blocks of
+// op(a) are found through at and block.
+template <class T> struct triangular_operand {
+  const T *data;
+  std::size_t ld;
+  matrix_op op;
+  bool unit;
+
+  bool transposed() const { return op == matrix_op::transpose; }
+  T at(std::size_t i, std::size_t j) const {
+    return transposed() ? data[j * ld + i] : data[i * ld + j];
+  }
+  // Stored address of the block of op(a) starting at (i, j), as gemm takes it
+  const T *block(std::size_t i, std::size_t j) const {
+    return transposed() ? data + j * ld + i : data + i * ld + j;
+  }
+};
+
+// Substitution on the whole of b, one triangle row or column at a time.
+// Rows of b are streamed, so this is the textbook algorithm as well as the
+// base case of the recursion.
+template <class T>
+void substitute(matrix_side side, bool lower, triangular_operand<T> a,
+                std::size_t m, std::size_t n, T *b, std::size_t ldb) {
+  if (side == matrix_side::left) {
+    // op(a) is m x m, row i of x follows from the rows solved before it
+    for (std::size_t step = 0; step < m; ++step) {
+      std::size_t i = lower ? step : m - 1 - step;
+      T *row = b + i * ldb;
+      std::size_t begin = lower ? 0 : i + 1;
+      std::size_t end = lower ? i : m;
+      for (std::size_t j = begin; j < end; ++j) {
+        scaled_row_add(row, b + j * ldb, -a.at(i, j), n);
+      }
+      if (!a.unit) {
+        T d = a.at(i, i);
+        for (std::size_t k = 0; k < n; ++k) {
+          row[k] /= d;
+        }
+      }
+    }
+    return;
+  }
+
+  // op(a) is n x n, each row of b is an independent x op(a) = b
+  for (std::size_t r = 0; r < m; ++r) {
+    T *x = b + r * ldb;
+    for (std::size_t step = 0; step < n; ++step) {
+      std::size_t j = lower ? n - 1 - step : step;
+      if (!a.unit) {
+        x[j] /= a.at(j, j);
+      }
+      std::size_t begin = lower ? 0 : j + 1;
+      std::size_t end = lower ? j : n;
+      for (std::size_t i = begin; i < end; ++i) {
+        x[i] -= x[j] * a.at(j, i);
+      }
+    }
+  }
+}
+
+// Splits the triangle in half, solving for one half of x, removing it from
+// the other half of b with a multiply and solving for that. The free
+// dimension of b is halved instead while it is the larger of the two, which
+// keeps subproblems square enough to fit the cache eventually.
+template <std::size_t Leaf, class T>
+void triangular_solve_helper(matrix_side side, bool lower,
+                             triangular_operand<T> a, std::size_t m,
+                             std::size_t n, T *b, std::size_t ldb) {
+  bool left = side == matrix_side::left;
+  std::size_t size = left ? m : n;
+  std::size_t free = left ? n : m;
+  if (free > size && free > Leaf) {
+    std::size_t half = free / 2;
+    if (left) {
+      triangular_solve_helper<Leaf>(side, lower, a, m, half, b, ldb);
+      triangular_solve_helper<Leaf>(side, lower, a, m, n - half, b + half,
+                                    ldb);
+    } else {
+      triangular_solve_helper<Leaf>(side, lower, a, half, n, b, ldb);
+      triangular_solve_helper<Leaf>(side, lower, a, m - half, n,
+                                    b + half * ldb, ldb);
+    }
+    return;
+  }
+  if (size <= Leaf) {
+    substitute(side, lower, a, m, n, b, ldb);
+    return;
+  }
+
+  std::size_t s1 = size / 2;
+  std::size_t s2 = size - s1;
+  triangular_operand<T> a11 = {a.block(0, 0), a.ld, a.op, a.unit};
+  triangular_operand<T> a22 = {a.block(s1, s1), a.ld, a.op, a.unit};
+  if (left) {
+    T *b2 = b + s1 * ldb;
+    if (lower) {
+      triangular_solve_helper<Leaf>(side, lower, a11, s1, n, b, ldb);
+      gemm(a.op, matrix_op::none, s2, s1, n, T(-1), a.block(s1, 0), a.ld, b,
+           ldb, T(1), b2, ldb);
+      triangular_solve_helper<Leaf>(side, lower, a22, s2, n, b2, ldb);
+    } else {
+      triangular_solve_helper<Leaf>(side, lower, a22, s2, n, b2, ldb);
+      gemm(a.op, matrix_op::none, s1, s2, n, T(-1), a.block(0, s1), a.ld, b2,
+           ldb, T(1), b, ldb);
+      triangular_solve_helper<Leaf>(side, lower, a11, s1, n, b, ldb);
+    }
+  } else {
+    T *b2 = b + s1;
+    if (lower) {
+      triangular_solve_helper<Leaf>(side, lower, a22, m, s2, b2, ldb);
+      gemm(matrix_op::none, a.op, m, s2, s1, T(-1), b2, ldb, a.block(s1, 0),
+           a.ld, T(1), b, ldb);
+      triangular_solve_helper<Leaf>(side, lower, a11, m, s1, b, ldb);
+    } else {
+      triangular_solve_helper<Leaf>(side, lower, a11, m, s1, b, ldb);
+      gemm(matrix_op::none, a.op, m, s1, s2, T(-1), b, ldb, a.block(0, s1),
+           a.ld, T(1), b2, ldb);
+      triangular_solve_helper<Leaf>(side, lower, a22, m, s2, b2, ldb);
+    }
+  }
+}
+
+template <class T>
+triangular_operand<T> make_triangular_operand(const T *a, std::size_t lda,
+                                              matrix_op op,
+                                              matrix_diagonal diag) {
+  return {a, lda, op, diag == matrix_diagonal::unit};
+}
+
+// op(a) is lower triangular if a is lower and not transposed, or upper and
+// transposed
+inline bool lower_after_op(matrix_triangle triangle, matrix_op op) {
+  return (triangle == matrix_triangle::lower) == (op == matrix_op::none);
+}
+} // namespace
+
+// Solves op(a) x = b or x op(a) = b for x with a triangular, overwriting
+// the m x n matrix b. a is m x m on the left and n x n on the right, with
+// row length lda; ldb is the row length of b. Leaf bounds the triangle of a
+// base case.
+template <class T, std::size_t Leaf = tuning<T>::solve_leaf>
+void triangular_solve(matrix_side side, matrix_triangle triangle,
+                      matrix_op op, matrix_diagonal diag, std::size_t m,
+                      std::size_t n, const T *a, std::size_t lda, T *b,
+                      std::size_t ldb) {
+  triangular_solve_helper<Leaf>(side, lower_after_op(triangle, op),
+                                make_triangular_operand(a, lda, op, diag), m,
+                                n, b, ldb);
+}
+
+template <class T>
+void naive_triangular_solve(matrix_side side, matrix_triangle triangle,
+                            matrix_op op, matrix_diagonal diag, std::size_t m,
+                            std::size_t n, const T *a, std::size_t lda, T *b,
+                            std::size_t ldb) {
+  substitute(side, lower_after_op(triangle, op),
+             make_triangular_operand(a, lda, op, diag), m, n, b, ldb);
+}
+} // namespace ra::cache
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+
+#include "multiply_kernels.hpp"
+
+namespace ra::cache {
+
+// Recursion cutoffs used when no tuned value is available for a type.
+// transpose_leaf bounds m * n, multiply_leaf bounds m * n * p and fft_leaf
+// bounds the transform length of a base case. Types with a register kernel
+// for multiply need much larger leaves to keep it busy. strassen_threshold
+// is the smallest dimension at which Strassen hands over to the classical
+// recursion. solve_leaf bounds the triangle of a triangular solve and the
+// panel width of LU and Cholesky base cases. split_fft_leaf bounds the
+// length of the split complex transforms done by iterative passes.
+template <class T> struct default_tuning {
+  static constexpr std::size_t transpose_leaf = 64;
+  static constexpr std::size_t multiply_leaf =
+      multiply_kernel<T>::mr > 0 ? 1 << 18 : 64;
+  static constexpr std::size_t fft_leaf = 64;
+  static constexpr std::size_t strassen_threshold = 512;
+  static constexpr std::size_t solve_leaf = 32;
+  static constexpr std::size_t split_fft_leaf = 1 << 12;
+};
+
+// Per element type cutoffs. Specialisations are generated by the autotune
+// target into tuning_generated.hpp and picked up when that file exists.
+template <class T> struct tuning : default_tuning<T> {};
+} // namespace ra::cache
+
+#if __has_include("tuning_generated.hpp")
+#include "tuning_generated.hpp"
+#endif